@@ -54,7 +54,7 @@ int64_t zero_guard(int64_t cycles_in, const char* warning)
   return max(zero, cycles_in);
 }
 
-void CommandAnalysis::handlePartialAct(unsigned int bank, std::vector<unsigned int> mats, int64_t timestamp)
+void CommandAnalysis::handlePartialAct(unsigned int bank, uint64_t mats, int64_t timestamp)
 {
   printWarningIfPoweredDown("Command issued while in power-down mode.", MemCommand::ACT, timestamp, bank);
   // If command is ACT - update number of acts, bank state of the
@@ -63,13 +63,17 @@ void CommandAnalysis::handlePartialAct(unsigned int bank, std::vector<unsigned i
   // If the bank is already active ignore the command and generate a
   // warning.
 
-  assert(mats.size() <= 8 && "Activated # of mats cannot exceed 8 for now");
+  unsigned nmats = __builtin_popcountll(mats);
+  assert(nmats > 0 && "EXPECTED MAT SIZE TO BE LARGER THAN ZERO");
+  assert(nmats <= 8 && "Activated # of mats cannot exceed 8 for now");
 
   // Record how many MATs were activated with this request
-  numberofpartialactsBanks[mats.size()-1][bank]++; 
+  numberofpartialactsBanks[nmats-1][bank]++; 
 
-  for (unsigned int mat : mats)
+  for (uint64_t rest = mats; rest != 0; rest &= rest - 1)
   {
+    unsigned mat = __builtin_ctzll(rest);
+
     // If any of the MATs are already active, ignore the command and generate a warning
     if (!isMatPrecharged(bank, mat))
     {
@@ -80,8 +84,6 @@ void CommandAnalysis::handlePartialAct(unsigned int bank, std::vector<unsigned i
     // Increment partial state that indicates how many MATs are open
     bank_partial_state[bank] += 1; 
     mat_state[bank][mat] = MAT_ACTIVE;
-
-    assert(mats.size() > 0 && "EXPECTED MAT SIZE TO BE LARGER THAN ZERO");
   }
 
   if (nActiveBanks() == 0) {
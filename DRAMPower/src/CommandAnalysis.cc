@@ -59,6 +59,11 @@ bool commandSorter(const MemCommand& i, const MemCommand& j)
   }
 }
 
+bool CommandAnalysis::LaterCommand::operator()(const MemCommand& i, const MemCommand& j) const
+{
+  return commandSorter(j, i);
+}
+
 CommandAnalysis::CommandAnalysis(const DRAMPower::MemorySpecification& memSpec) :
   memSpec(memSpec)
 
@@ -186,6 +191,8 @@ void CommandAnalysis::clear()
 {
   cached_cmd.clear();
   cmd_list.clear();
+  next_window_cmd_list.clear();
+  auto_precharges = decltype(auto_precharges)();
   last_bank_state.clear();
   bank_state.clear();
   bank_partial_state.clear();
@@ -193,17 +200,12 @@ void CommandAnalysis::clear()
 
 // Reads through the trace file, identifies the timestamp, command and bank
 // If the issued command includes an auto-precharge, adds an explicit
-// precharge to a cached command list and computes the precharge offset from the
+// precharge to the pending precharges and computes the precharge offset from the
 // issued command timestamp, when the auto-precharge would kick in
 
 void CommandAnalysis::getCommands(std::vector<MemCommand>& list, bool lastupdate, int64_t timestamp)
 {
-  if (!next_window_cmd_list.empty()) {
-    list.insert(list.begin(), next_window_cmd_list.begin(), next_window_cmd_list.end());
-    next_window_cmd_list.clear();
-  }
-  for (size_t i = 0; i < list.size(); ++i) {
-    MemCommand& cmd = list[i];
+  for (MemCommand& cmd : list) {
     MemCommand::cmds cmdType = cmd.getType();
     if (cmdType == MemCommand::ACT || cmdType == MemCommand::PARTIAL_ACT) {
       activation_cycle[cmd.getBank()] = cmd.getTimeInt64();
@@ -211,87 +213,122 @@ void CommandAnalysis::getCommands(std::vector<MemCommand>& list, bool lastupdate
       // Remove auto-precharge flag from command
       cmd.setType(cmd.typeWithoutAutoPrechargeFlag());
 
-      // Add the auto precharge to the list of cached_cmds
+      // Add the auto precharge to the pending precharges
       int64_t preTime = max(cmd.getTimeInt64() + cmd.getPrechargeOffset(memSpec, cmdType),
                            activation_cycle[cmd.getBank()] + memSpec.memTimingSpec.RAS);
-      list.push_back(MemCommand(MemCommand::PRE, cmd.getBank(), preTime));
+      auto_precharges.push(MemCommand(MemCommand::PRE, cmd.getBank(), preTime));
     }
+  }
 
-    if (!lastupdate && timestamp > 0) {
-      if(cmd.getTimeInt64() > timestamp)
-      {
-          MemCommand nextWindowCmd = list[i];
-          next_window_cmd_list.push_back(nextWindowCmd);
-          list.erase(find(list.begin(), list.end(), cmd));
-      }
+  // Commands are usually given in issue order, which is already sorted
+  if (!is_sorted(list.begin(), list.end(), commandSorter))
+    stable_sort(list.begin(), list.end(), commandSorter);
+
+  // Commands after the window are evaluated with the next window
+  bool split = !lastupdate && timestamp > 0;
+
+  // Merge the commands of the previous windows, the new commands and the
+  // auto precharges in time order
+  auto next = list.begin();
+  MemCommand last;
+  bool evaluated = false;
+  while (true) {
+    enum { NONE, PENDING, PRECHARGE, NEW } source = NONE;
+    const MemCommand* earliest = nullptr;
+    if (!next_window_cmd_list.empty()) {
+      earliest = &next_window_cmd_list.front();
+      source = PENDING;
+    }
+    if (!auto_precharges.empty() && (!earliest || commandSorter(auto_precharges.top(), *earliest))) {
+      earliest = &auto_precharges.top();
+      source = PRECHARGE;
     }
+    if (next != list.end() && (!earliest || commandSorter(*next, *earliest))) {
+      earliest = &*next;
+      source = NEW;
+    }
+    if (!earliest || (split && earliest->getTimeInt64() > timestamp))
+      break;
+
+    evaluateCommand(*earliest);
+    last = *earliest;
+    evaluated = true;
+    if (source == PENDING)
+      next_window_cmd_list.pop_front();
+    else if (source == PRECHARGE)
+      auto_precharges.pop();
+    else
+      ++next;
   }
-  sort(list.begin(), list.end(), commandSorter);
 
-  if (lastupdate && list.empty() == false) {
-    // Add cycles at the end of the list
-    int64_t t = timeToCompletion(list.back().getType()) + list.back().getTimeInt64() - 1;
-    list.push_back(MemCommand(MemCommand::NOP, 0, t));
+  if (next != list.end()) {
+    // Both the remaining commands and the ones of the next window are sorted
+    size_t pending = next_window_cmd_list.size();
+    next_window_cmd_list.insert(next_window_cmd_list.end(), next, list.end());
+    if (pending > 0 && commandSorter(*next, next_window_cmd_list[pending - 1]))
+      inplace_merge(next_window_cmd_list.begin(), next_window_cmd_list.begin() + pending,
+                    next_window_cmd_list.end(), commandSorter);
   }
 
-  evaluateCommands(list);
+  if (lastupdate && evaluated) {
+    // Add cycles at the end of the list
+    int64_t t = timeToCompletion(last.getType()) + last.getTimeInt64() - 1;
+    evaluateCommand(MemCommand(MemCommand::NOP, 0, t));
+  }
 } // CommandAnalysis::getCommands
 
 
-// Used to analyse a given list of commands and identify command timings
+// Used to analyse a given command and identify command timings
 // and memory state transitions
-void CommandAnalysis::evaluateCommands(vector<MemCommand>& cmd_list)
+void CommandAnalysis::evaluateCommand(const MemCommand& cmd)
 {
-  // for each command identify timestamp, type and bank
-  for (auto cmd : cmd_list) {
-    // For command type
-    int type = cmd.getType();
-    // For command bank
-    unsigned bank = cmd.getBank();
-    std::vector<unsigned int> mats = cmd.getMats();
-    // Command Issue timestamp in clock cycles (cc)
-    int64_t timestamp = cmd.getTimeInt64();
-
-    if (type == MemCommand::ACT) {
-      handleAct(bank, timestamp);
-    } else if (type == MemCommand::PARTIAL_ACT){
-      handlePartialAct(bank, mats, timestamp);
-    } else if (type == MemCommand::RD) {
-      handleRd(bank, timestamp);
-    } else if (type == MemCommand::WR) {
-      handleWr(bank, timestamp);
-    } else if (type == MemCommand::REF) {
-      handleRef(bank, timestamp);
-    } else if (type == MemCommand::REFB) {
-      handleRefB(bank, timestamp);
-    } else if (type == MemCommand::PRE) {
-      handlePre(bank, timestamp);
-    } else if (type == MemCommand::PREA) {
-      handlePreA(bank, timestamp);
-    } else if (type == MemCommand::PDN_F_ACT) {
-      handlePdnFAct(bank, timestamp);
-    } else if (type == MemCommand::PDN_S_ACT) {
-      handlePdnSAct(bank, timestamp);
-    } else if (type == MemCommand::PDN_F_PRE) {
-      handlePdnFPre(bank, timestamp);
-    } else if (type == MemCommand::PDN_S_PRE) {
-      handlePdnSPre(bank, timestamp);
-    } else if (type == MemCommand::PUP_ACT) {
-      handlePupAct(timestamp);
-    } else if (type == MemCommand::PUP_PRE) {
-      handlePupPre(timestamp);
-    } else if (type == MemCommand::SREN) {
-      handleSREn(bank, timestamp);
-    } else if (type == MemCommand::SREX) {
-      handleSREx(bank, timestamp);
-    } else if (type == MemCommand::END || type == MemCommand::NOP) {
-      handleNopEnd(timestamp);
-    } else {
-      printWarning("Unknown command given, exiting.", type, timestamp, bank);
-      exit(-1);
-    }
+  // For command type
+  int type = cmd.getType();
+  // For command bank
+  unsigned bank = cmd.getBank();
+  uint64_t mats = cmd.getMats();
+  // Command Issue timestamp in clock cycles (cc)
+  int64_t timestamp = cmd.getTimeInt64();
+
+  if (type == MemCommand::ACT) {
+    handleAct(bank, timestamp);
+  } else if (type == MemCommand::PARTIAL_ACT){
+    handlePartialAct(bank, mats, timestamp);
+  } else if (type == MemCommand::RD) {
+    handleRd(bank, timestamp);
+  } else if (type == MemCommand::WR) {
+    handleWr(bank, timestamp);
+  } else if (type == MemCommand::REF) {
+    handleRef(bank, timestamp);
+  } else if (type == MemCommand::REFB) {
+    handleRefB(bank, timestamp);
+  } else if (type == MemCommand::PRE) {
+    handlePre(bank, timestamp);
+  } else if (type == MemCommand::PREA) {
+    handlePreA(bank, timestamp);
+  } else if (type == MemCommand::PDN_F_ACT) {
+    handlePdnFAct(bank, timestamp);
+  } else if (type == MemCommand::PDN_S_ACT) {
+    handlePdnSAct(bank, timestamp);
+  } else if (type == MemCommand::PDN_F_PRE) {
+    handlePdnFPre(bank, timestamp);
+  } else if (type == MemCommand::PDN_S_PRE) {
+    handlePdnSPre(bank, timestamp);
+  } else if (type == MemCommand::PUP_ACT) {
+    handlePupAct(timestamp);
+  } else if (type == MemCommand::PUP_PRE) {
+    handlePupPre(timestamp);
+  } else if (type == MemCommand::SREN) {
+    handleSREn(bank, timestamp);
+  } else if (type == MemCommand::SREX) {
+    handleSREx(bank, timestamp);
+  } else if (type == MemCommand::END || type == MemCommand::NOP) {
+    handleNopEnd(timestamp);
+  } else {
+    printWarning("Unknown command given, exiting.", type, timestamp, bank);
+    exit(-1);
   }
-} // CommandAnalysis::evaluateCommands
+} // CommandAnalysis::evaluateCommand
 
 // To update idle period information whenever active cycles may be idle
 void CommandAnalysis::idle_act_update(int64_t latest_read_cycle, int64_t latest_write_cycle,
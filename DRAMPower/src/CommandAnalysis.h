@@ -48,6 +48,7 @@
 #include <vector>
 #include <iostream>
 #include <deque>
+#include <queue>
 #include <string>
 
 #include "MemCommand.h"
@@ -142,7 +143,9 @@ class CommandAnalysis {
   // function for clearing arrays
   void clear();
 
-  // To identify auto-precharges
+  // To identify auto-precharges and evaluate the commands up to timestamp
+  // (all of them if it is 0 or lastupdate is set). The commands after it are
+  // kept for the next call. The list is sorted in place if it is not in time order.
   void getCommands(std::vector<MemCommand>&   list,
                    bool                       lastupdate,
                    int64_t timestamp = 0);
@@ -171,8 +174,16 @@ class CommandAnalysis {
   // Stores the memory commands for analysis
   std::vector<MemCommand> cmd_list;
 
-  //Stores the memory commands for the next window
-  std::vector<MemCommand> next_window_cmd_list;
+  // Orders commands from the latest to the earliest (see commandSorter)
+  struct LaterCommand {
+    bool operator()(const MemCommand& i, const MemCommand& j) const;
+  };
+
+  //Stores the memory commands for the next window, in time order
+  std::deque<MemCommand> next_window_cmd_list;
+
+  // Precharges of auto-precharge commands that are not evaluated yet
+  std::priority_queue<MemCommand, std::vector<MemCommand>, LaterCommand> auto_precharges;
 
   // To save states of the different banks, before entering active
   // power-down mode (slow/fast-exit).
@@ -222,12 +233,12 @@ class CommandAnalysis {
   // Clock cycle of last precharge command when memory state changes to PRE
   int64_t last_pre_cycle;
 
-  // To perform timing analysis of a given set of commands and update command counters
-  void evaluateCommands(std::vector<MemCommand>& cmd_list);
+  // To perform timing analysis of a given command and update command counters
+  void evaluateCommand(const MemCommand& cmd);
 
   // Handlers for commands that are getting processed
   void handleAct(    unsigned bank, int64_t timestamp);
-  void handlePartialAct(    unsigned bank, std::vector<unsigned int> mats, int64_t timestamp);
+  void handlePartialAct(    unsigned bank, uint64_t mats, int64_t timestamp);
   void handleRd(     unsigned bank, int64_t timestamp);
   void handleWr(     unsigned bank, int64_t timestamp);
   void handleRef(    unsigned bank, int64_t timestamp);
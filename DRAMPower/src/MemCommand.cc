@@ -49,7 +49,8 @@ MemCommand::MemCommand(MemCommand::cmds type,
                        unsigned bank, int64_t timestamp) :
   type(type),
   bank(bank),
-  timestamp(timestamp)
+  timestamp(timestamp),
+  mats(0)
 {
 }
 
@@ -73,18 +74,12 @@ unsigned MemCommand::getBank() const
   return bank;
 }
 
-void MemCommand::setMat(int64_t _mat)
+void MemCommand::setMat(uint64_t _mats)
 {
-  for(unsigned i = 0 ; i < sizeof(int64_t)*8 ; i++)
-  {
-    if (_mat & 0x1)
-      mats.push_back(i);
-    
-    _mat >>= 1;
-  }
+  mats = _mats;
 }
 
-std::vector<unsigned int> MemCommand::getMats() const
+uint64_t MemCommand::getMats() const
 {
   return mats;
 }
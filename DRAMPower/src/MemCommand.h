@@ -103,8 +103,6 @@ class MemCommand {
     // Command Issue Timestamp (in cc)
     int64_t          timestamp = 0L);
 
-  std::vector<unsigned int> mats;
-
   // Get command type
   cmds getType() const;
 
@@ -117,11 +115,11 @@ class MemCommand {
   // Get target Bank
   unsigned getBank() const;
 
-  // Set target MAT(s)
-  void setMat(int64_t mat);
+  // Set target MAT(s), bit i of the mask selects MAT i
+  void setMat(uint64_t mats);
 
-  // Get target MATs
-  std::vector<unsigned int> getMats() const;
+  // Get target MATs as a bit mask
+  uint64_t getMats() const;
 
   // Set timestamp
   void setTime(int64_t _timestamp);
@@ -196,6 +194,7 @@ class MemCommand {
   MemCommand::cmds type;
   unsigned bank;
   int64_t timestamp;
+  uint64_t mats;
 };
 }
 #endif // ifndef MEMCOMMAND_H
@@ -36,11 +36,84 @@
  */
 #include "TraceParser.h"
 
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "CommandAnalysis.h"
 
 using namespace DRAMPower;
 using namespace std;
 
+namespace {
+// A read-only memory mapping of a whole file
+class MappedFile {
+ public:
+  explicit MappedFile(const string& path) : data(nullptr), size(0)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw runtime_error("Cannot open the command trace " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw runtime_error("Cannot read the command trace " + path);
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+      void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map == MAP_FAILED) {
+        close(fd);
+        throw runtime_error("Cannot map the command trace " + path);
+      }
+      madvise(map, size, MADV_SEQUENTIAL);
+      data = static_cast<const char*>(map);
+    }
+    close(fd);
+  }
+
+  ~MappedFile()
+  {
+    if (data)
+      munmap(const_cast<char*>(data), size);
+  }
+
+  const char* data;
+  size_t size;
+
+ private:
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+};
+
+MemCommand::cmds getTypeFromName(const char* name, size_t len)
+{
+  const string* typeStrings = MemCommand::getCommandTypeStrings();
+
+  for (size_t typeId = 0; typeId < MemCommand::nCommands; typeId++) {
+    if (typeStrings[typeId].size() == len && typeStrings[typeId].compare(0, len, name, len) == 0)
+      return static_cast<MemCommand::cmds>(typeId);
+  }
+  return MemCommand::UNINITIALIZED;
+}
+
+// Parses the decimal number at pos, returns the position after it or
+// nullptr if there is none.
+const char* parseNumber(const char* pos, const char* end, uint64_t& value)
+{
+  while (pos < end && (*pos == ' ' || *pos == '\t'))
+    pos++;
+  const char* digits = pos;
+  value = 0;
+  for (; pos < end && *pos >= '0' && *pos <= '9'; pos++)
+    value = value * 10 + static_cast<uint64_t>(*pos - '0');
+  return pos == digits ? nullptr : pos;
+}
+}
+
 TraceParser::TraceParser(const MemorySpecification& memSpec) :
   counters(memSpec)
 {
@@ -50,56 +123,141 @@ TraceParser::TraceParser(const MemorySpecification& memSpec) :
 DRAMPower::MemCommand TraceParser::parseLine(std::string line)
 {
   MemCommand memcmd(MemCommand::UNINITIALIZED, 0, 0);
-  istringstream linestream(line);
-  string item;
-  int64_t item_val;
-  unsigned itemnum = 0;
-
-  while (getline(linestream, item, ',')) {
-    if (itemnum == 0) {
-      stringstream timestamp(item);
-      timestamp >> item_val;
-      memcmd.setTime(item_val);
-    } else if (itemnum == 1) {
-      item_val = MemCommand::getTypeFromName(item);
-      memcmd.setType(static_cast<MemCommand::cmds>(item_val));
-    } else if (itemnum == 2) {
-      stringstream bank(item);
-      bank >> item_val;
-      memcmd.setBank(static_cast<unsigned>(item_val));
-    } else if (itemnum == 3) {
-      stringstream mats(item);
-      mats >> item_val;
-      memcmd.setMat(item_val);
-    }
-    itemnum++;
-  }
+  parseLine(line.data(), line.data() + line.size(), memcmd);
   return memcmd;
 } // TraceParser::parseLine
 
-void TraceParser::parseFile(MemorySpecification memSpec, std::ifstream& trace, int window)
+bool TraceParser::parseLine(const char* begin, const char* end, MemCommand& memcmd)
+{
+  if (begin < end && end[-1] == '\r')
+    end--;
+  if (begin == end)
+    return false;
+  memcmd = MemCommand();
+
+  // <timestamp>,<command>[,<bank>[,<mats>]]
+  uint64_t item_val;
+  const char* pos = parseNumber(begin, end, item_val);
+  if (!pos || pos == end || *pos != ',')
+    throw runtime_error("Malformed command trace line: " + string(begin, end));
+  memcmd.setTime(static_cast<int64_t>(item_val));
+
+  const char* name = ++pos;
+  pos = static_cast<const char*>(memchr(name, ',', static_cast<size_t>(end - name)));
+  if (!pos)
+    pos = end;
+  MemCommand::cmds type = getTypeFromName(name, static_cast<size_t>(pos - name));
+  if (type == MemCommand::UNINITIALIZED)
+    throw runtime_error("Unknown command in the command trace: " + string(name, pos));
+  memcmd.setType(type);
+
+  if (pos < end) {
+    pos = parseNumber(pos + 1, end, item_val);
+    if (!pos)
+      throw runtime_error("Malformed command trace line: " + string(begin, end));
+    memcmd.setBank(static_cast<unsigned>(item_val));
+  }
+  if (pos < end && *pos == ',') {
+    pos = parseNumber(pos + 1, end, item_val);
+    if (!pos)
+      throw runtime_error("Malformed command trace line: " + string(begin, end));
+    memcmd.setMat(item_val);
+  }
+  return true;
+} // TraceParser::parseLine
+
+void TraceParser::addCommand(const MemCommand& cmd, int window)
 {
-  ifstream pwr_trace;
+  cmd_list.push_back(cmd);
+  if (cmd_list.size() == static_cast<size_t>(window)) {
+    counters.getCommands(cmd_list, false);
+    cmd_list.clear();
+  }
+}
 
-  int  nCommands  = 0;
-  bool lastupdate = false;
+void TraceParser::parseFile(MemorySpecification memSpec, std::ifstream& trace, int window)
+{
   counters = CommandAnalysis(memSpec);
 
   std::string line;
+  MemCommand cmdline;
   while (getline(trace, line)) {
-    MemCommand cmdline = parseLine(line);
-    cmd_list.push_back(cmdline);
-    nCommands++;
-    if (nCommands == window) {
-      counters.getCommands(cmd_list, lastupdate);
-      nCommands = 0;
-      cmd_list.clear();
-    }
+    if (parseLine(line.data(), line.data() + line.size(), cmdline))
+      addCommand(cmdline, window);
   }
-  lastupdate = true;
-  counters.getCommands(cmd_list, lastupdate);
+  counters.getCommands(cmd_list, true);
   cmd_list.clear();
 
   counters.clear();
   trace.close();
 } // TraceParser::parseFile
+
+void TraceParser::parseFile(const MemorySpecification& memSpec, const std::string& path, int window)
+{
+  counters = CommandAnalysis(memSpec);
+  cmd_list.reserve(static_cast<size_t>(window));
+
+  MappedFile trace(path);
+  if (trace.size >= sizeof(BinaryTrace::MAGIC) &&
+      memcmp(trace.data, BinaryTrace::MAGIC, sizeof(BinaryTrace::MAGIC)) == 0)
+    parseBinary(trace.data, trace.size, window);
+  else
+    parseText(trace.data, trace.size, window);
+  counters.getCommands(cmd_list, true);
+  cmd_list.clear();
+
+  counters.clear();
+} // TraceParser::parseFile
+
+void TraceParser::parseText(const char* data, size_t size, int window)
+{
+  const char* end = data + size;
+  MemCommand cmd;
+  for (const char* pos = data; pos < end; ) {
+    const char* eol = static_cast<const char*>(memchr(pos, '\n', static_cast<size_t>(end - pos)));
+    if (!eol)
+      eol = end;
+    if (parseLine(pos, eol, cmd))
+      addCommand(cmd, window);
+    pos = eol + 1;
+  }
+}
+
+void TraceParser::parseBinary(const char* data, size_t size, int window)
+{
+  BinaryTrace::Header header;
+  if (size < sizeof(header))
+    throw runtime_error("Truncated binary command trace");
+  memcpy(&header, data, sizeof(header));
+  if (header.version != BinaryTrace::VERSION || header.record_size != sizeof(BinaryTrace::Record))
+    throw runtime_error("Unsupported binary command trace version");
+
+  size_t offset = sizeof(header) + header.commands * sizeof(BinaryTrace::CommandName);
+  if (offset > size || (size - offset) % sizeof(BinaryTrace::Record) != 0)
+    throw runtime_error("Truncated binary command trace");
+
+  // commands of the trace that DRAMPower does not know are only an error
+  // if they are used
+  vector<MemCommand::cmds> types(header.commands);
+  vector<string> names(header.commands);
+  for (size_t i = 0; i < header.commands; i++) {
+    const char* name = data + sizeof(header) + i * sizeof(BinaryTrace::CommandName);
+    names[i] = string(name, strnlen(name, sizeof(BinaryTrace::CommandName)));
+    types[i] = getTypeFromName(names[i].data(), names[i].size());
+  }
+
+  int64_t timestamp = 0;
+  const BinaryTrace::Record* rec = reinterpret_cast<const BinaryTrace::Record*>(data + offset);
+  const BinaryTrace::Record* end = reinterpret_cast<const BinaryTrace::Record*>(data + size);
+  for (; rec < end; rec++) {
+    timestamp += rec->delta;
+    if (rec->command == BinaryTrace::NO_COMMAND)
+      continue;
+    if (rec->command >= types.size() || types[rec->command] == MemCommand::UNINITIALIZED)
+      throw runtime_error("Unknown command in the command trace: " +
+                          (rec->command < names.size() ? names[rec->command] : to_string(rec->command)));
+    MemCommand cmd(types[rec->command], rec->bank, timestamp);
+    cmd.setMat(rec->sectors);
+    addCommand(cmd, window);
+  }
+}
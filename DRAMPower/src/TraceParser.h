@@ -41,11 +41,45 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <stdint.h>
 
 #include "MemCommand.h"
 #include "MemorySpecification.h"
 #include "CommandAnalysis.h"
 
+// Binary command trace of a rank as written by ramulator with
+// cmd_trace_format = binary (ramulator/src/CmdTraceFormat.h): a header with
+// the command names, followed by fixed-width records, one per command, with
+// the cycles since the previous record. The layout must match the one in
+// ramulator/src/CmdTraceFormat.h.
+namespace BinaryTrace {
+const char MAGIC[8] = { 'R', 'A', 'M', 'C', 'M', 'D', 'B', 'N' };
+const uint32_t VERSION = 1;
+const uint8_t NO_COMMAND = 0xff; // a record that only advances the time
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t commands; // followed by this many CommandNames
+  uint32_t reserved;
+};
+
+struct CommandName {
+  char name[16];
+};
+
+struct Record {
+  uint32_t delta;
+  uint8_t command;
+  uint8_t sectors;
+  uint16_t bank;
+};
+
+static_assert(sizeof(Header) == 24, "unexpected binary command trace header layout");
+static_assert(sizeof(CommandName) == 16, "unexpected binary command trace name layout");
+static_assert(sizeof(Record) == 8, "unexpected binary command trace record layout");
+}
 
 class TraceParser {
  public:
@@ -62,6 +96,21 @@ class TraceParser {
   void parseFile(DRAMPower::MemorySpecification memSpec,
                  std::ifstream&      trace,
                  int                 window);
+
+  // Maps the trace file into memory and parses it in place. The file is
+  // either a text trace or a binary trace, detected by its header.
+  void parseFile(const DRAMPower::MemorySpecification& memSpec,
+                 const std::string&  path,
+                 int                 window);
+
+ private:
+  // Parses the line in [begin, end) without copying it. Returns false for
+  // an empty line, throws for a malformed one.
+  bool parseLine(const char* begin, const char* end, DRAMPower::MemCommand& cmd);
+  void parseText(const char* data, size_t size, int window);
+  void parseBinary(const char* data, size_t size, int window);
+  // hands the parsed commands to the analysis once there are window many
+  void addCommand(const DRAMPower::MemCommand& cmd, int window);
 };
 
 #endif // ifndef TRACE_PARSER_H
@@ -37,6 +37,13 @@
  */
  #include "CliHandler.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <thread>
+
 using namespace std;
 using namespace DRAMPower;
 
@@ -46,11 +53,12 @@ CliHandler::CliHandler(int _argc, char** _argv):
   io_term_active(false),
   pa_enable(false),
   mem_spec_path(""),
-  cmd_trace_path(""),
+  cmd_trace_paths(),
   bank_wise_parms({-1,-1}),
   bank_wise_active(false),
   pasr_mode(-1),
-  pasr_active(false){
+  pasr_active(false),
+  jobs(std::max(1u, std::thread::hardware_concurrency())){
 }
 
 CliHandler::~CliHandler(){
@@ -87,8 +95,8 @@ void CliHandler::parse_arguments(){
                     ->required()
                     ->check(CLI::ExistingFile); 
     app->add_option(CMD_TRACE,
-                    cmd_trace_path,
-                    "Commands trace file")
+                    cmd_trace_paths,
+                    "Commands trace files, text or binary, one per rank")
                     ->required()
                     ->check(CLI::ExistingFile);
     CLI::Option* bw_option { app->add_option(BANK_WISE,
@@ -102,6 +110,10 @@ void CliHandler::parse_arguments(){
                     "Partial Array Self-Refresh mode" )
                     ->needs(bw_option)
                     ->check(CLI::Range(0,7));
+    app->add_option(JOBS,
+                    jobs,
+                    "Number of command traces analyzed in parallel")
+                    ->check(CLI::Range(1,1024));
 
     app->parse(argc, argv);
 
@@ -126,8 +138,8 @@ const std::string& CliHandler::get_mem_spec_path() const{
   return mem_spec_path;
 }
 
-const std::string& CliHandler::get_cmd_trace_path() const{
-  return cmd_trace_path;
+const std::vector<std::string>& CliHandler::get_cmd_trace_paths() const{
+  return cmd_trace_paths;
 }
 
 bool CliHandler::get_bank_wise_active() const{
@@ -160,6 +172,10 @@ int CliHandler::get_pasr_mode() const{
   return pasr_mode;
 }
 
+unsigned CliHandler::get_jobs() const{
+  return jobs;
+}
+
 void CliHandler::run_simulation(){
   MemorySpecification  memSpec(MemSpecParser::getMemSpecFromXML(get_mem_spec_path()));
   // Replace the memory specification XML file with another in the same format
@@ -171,17 +187,12 @@ void CliHandler::run_simulation(){
                                 get_pasr_mode(),
                                 get_bank_wise_active(),
                                 (unsigned)memArchSpec.nbrOfBanks);
-  MemoryPowerModel mpm = MemoryPowerModel();
-  mpm.pa_enable = pa_enable;
-  TraceParser traceparser(memSpec);
-    
+
   if ((memArchSpec.twoVoltageDomains) && (get_bank_wise_active())){
       cout << endl << "Bankwise simulation for Two-Voltage domain devices not supported." << endl;
       std::exit(EXIT_FAILURE);
   }  
-  const clock_t begin_time = clock();  
-  ifstream trace_file;
-  trace_file.open(get_cmd_trace_path(), ifstream::in);  
+  const auto begin_time = std::chrono::steady_clock::now();
   time_t start   = time(0);
   tm*    starttm = localtime(&start);
   cout << "* Analysis start time: " << asctime(starttm);
@@ -200,18 +211,67 @@ void CliHandler::run_simulation(){
   }else{
        cout << "disabled" << endl;
   }
-  // Calculates average power consumption and energy for the input memory
-  // command trace
+  // Calculates average power consumption and energy for each input memory
+  // command trace. The traces, one per rank, are independent and are
+  // parsed and analyzed in parallel.
   const int CMD_ANALYSIS_WINDOW_SIZE = 1000000;
-  traceparser.parseFile(memSpec, trace_file, CMD_ANALYSIS_WINDOW_SIZE);
-  mpm.power_calc(memSpec, traceparser.counters,  get_io_term_active(), memBwParams);  
-  mpm.power_print(memSpec,
-                  get_io_term_active(),
-                  traceparser.counters,
-                  get_bank_wise_active());  
+  const std::vector<std::string>& traces = get_cmd_trace_paths();
+  std::vector<std::unique_ptr<TraceParser>> traceparsers;
+  std::vector<MemoryPowerModel> mpms(traces.size());
+  std::vector<std::exception_ptr> errors(traces.size());
+  for (size_t i = 0; i < traces.size(); i++) {
+    traceparsers.emplace_back(new TraceParser(memSpec));
+    mpms[i].pa_enable = pa_enable;
+  }
+
+  std::atomic<size_t> next_trace(0);
+  auto analyze = [&]() {
+    for (size_t i = next_trace++; i < traces.size(); i = next_trace++) {
+      try {
+        traceparsers[i]->parseFile(memSpec, traces[i], CMD_ANALYSIS_WINDOW_SIZE);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t j = 0; j < std::min<size_t>(get_jobs(), traces.size()); j++)
+    workers.emplace_back(analyze);
+  for (auto& worker : workers)
+    worker.join();
+  for (auto& error : errors) {
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  double total_energy = 0.0;
+  double total_power = 0.0;
+  for (size_t i = 0; i < traces.size(); i++) {
+    if (traces.size() > 1)
+      cout << endl << "* Command trace: " << traces[i] << endl;
+    mpms[i].power_calc(memSpec, traceparsers[i]->counters, get_io_term_active(), memBwParams);
+    mpms[i].power_print(memSpec,
+                        get_io_term_active(),
+                        traceparsers[i]->counters,
+                        get_bank_wise_active());
+    total_energy += mpms[i].energy.total_energy;
+    total_power += mpms[i].power.average_power;
+  }
+  if (traces.size() > 1) {
+    // the ranks operate concurrently, so their average powers add up
+    ios_base::fmtflags flags = cout.flags();
+    streamsize precision = cout.precision();
+    cout.precision(2);
+    cout << endl << "* All " << traces.size() << " command traces:" << fixed << endl
+         << endl << "Total Energy of All Traces: " << total_energy << " pJ"
+         << endl << "Average Power of All Traces: " << total_power << " mW"
+         << endl << "----------------------------------------" << endl;
+    cout.flags(flags);
+    cout.precision(precision);
+  }
   time_t end   = time(0);
   tm*    endtm = localtime(&end);
   cout << "* Power Computation End time: " << asctime(endtm);
   cout << "* Total Simulation time: " 
-       << float(clock() - begin_time) / CLOCKS_PER_SEC << " seconds" << endl;
+       << std::chrono::duration<float>(std::chrono::steady_clock::now() - begin_time).count() << " seconds" << endl;
 }
@@ -56,6 +56,7 @@ constexpr const char* PA_ENABLE("--pa_enable,-p");
 constexpr const char* CMD_TRACE("--cmd_trace,-c");
 constexpr const char* BANK_WISE("--bank_wise,-b");
 constexpr const char* PASR_MODE("--pasr,-s");
+constexpr const char* JOBS("--jobs,-j");
 
 class CliHandler{
 public:
@@ -64,12 +65,13 @@ public:
 
   bool get_io_term_active() const;
   const std::string& get_mem_spec_path() const;
-  const std::string& get_cmd_trace_path() const;
+  const std::vector<std::string>& get_cmd_trace_paths() const;
   bool get_bank_wise_active() const;
   int get_bank_wise_rho() const;
   int get_bank_wise_sigma() const;
   bool get_pasr_active() const;
   int get_pasr_mode() const;
+  unsigned get_jobs() const;
 
   void parse_arguments();
   void run_simulation();
@@ -82,11 +84,12 @@ private:
   bool io_term_active;
   bool pa_enable;
   std::string mem_spec_path;
-  std::string cmd_trace_path;
+  std::vector<std::string> cmd_trace_paths;
   std::vector<int> bank_wise_parms;
   bool bank_wise_active;
   int pasr_mode;
   bool pasr_active;
+  unsigned jobs;
 };
 
 }
@@ -65,7 +65,7 @@ libDRAMPower::~libDRAMPower()
 {
 }
 
-void libDRAMPower::doCommand(MemCommand::cmds type, int bank, int64_t timestamp, uint64_t mats)
+void libDRAMPower::doCommand(MemCommand::cmds type, int bank, int64_t timestamp, uint64_t mats, int64_t issue)
 {
   MemCommand cmd(type, static_cast<unsigned>(bank), timestamp);
 
@@ -75,7 +75,16 @@ void libDRAMPower::doCommand(MemCommand::cmds type, int bank, int64_t timestamp,
 
   cmd.setMat(mats);
 
+  if (cmdList.empty())
+    cmdList.reserve(CMD_CHUNK_SIZE);
   cmdList.push_back(cmd);
+
+  // No later command can precede the issue cycle, so the commands before it
+  // are evaluated now and the rest are kept for the next chunk
+  if (issue < 0)
+    issue = timestamp;
+  if (cmdList.size() >= CMD_CHUNK_SIZE && issue > 1)
+    updateCounters(false, issue - 1);
 }
 
 void libDRAMPower::enableHalfDRAM()
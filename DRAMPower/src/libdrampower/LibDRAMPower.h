@@ -62,10 +62,15 @@ class libDRAMPower : public libDRAMPowerDummy {
   libDRAMPower(const DRAMPower::MemorySpecification& memSpec, bool includeIoAndTermination,const DRAMPower::MemBankWiseParams& bwPowerParams);
   ~libDRAMPower();
 
+  // mats: bit mask of the activated MATs, 0 activates all of them.
+  // issue: cycle the command is issued at if its timestamp is later (e.g.,
+  // the sector bursts of a fine-grained read). Commands issued afterwards
+  // must not be timestamped before it.
   void doCommand(DRAMPower::MemCommand::cmds type,
                  int                    bank,
                  int64_t                timestamp,
-                 uint64_t               mats);
+                 uint64_t               mats = 0,
+                 int64_t                issue = -1);
 
   void calcEnergy();
 
@@ -76,9 +81,13 @@ class libDRAMPower : public libDRAMPowerDummy {
 
   void enableHalfDRAM();
 
-  // list of all commands
+  // commands that are not evaluated yet
   std::vector<DRAMPower::MemCommand> cmdList;
  private:
+  // Commands before the issue cycle are evaluated whenever this many are
+  // buffered, so long windows do not keep all of their commands in memory
+  static const size_t CMD_CHUNK_SIZE = 4096;
+
   void updateCounters(bool lastUpdate, int64_t timestamp = 0);
 
   void clearCounters(int64_t timestamp);
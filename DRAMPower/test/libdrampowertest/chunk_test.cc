@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2014, TU Delft, TU Eindhoven and TU Kaiserslautern
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Checks that the commands buffered by doCommand and evaluated in chunks
+// give the same energies as evaluating each window at once. The windows
+// hold several chunks of commands, including sector reads that are
+// timestamped after their issue cycle and out of order, and the auto
+// precharges of RDA commands.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include "libdrampower/LibDRAMPower.h"
+#if USE_XERCES
+    #include "xmlparser/MemSpecParser.h"
+#endif
+
+
+using namespace std;
+using namespace DRAMPower;
+
+// Issues a command to both models: through doCommand for the chunked one,
+// and straight into the command list for the reference one, which is then
+// evaluated at the end of the window only.
+static void push(libDRAMPower& chunked, libDRAMPower& reference,
+                 MemCommand::cmds type, int bank, int64_t timestamp, int64_t issue)
+{
+  chunked.doCommand(type, bank, timestamp, 0, issue);
+
+  MemCommand cmd(type, static_cast<unsigned>(bank), timestamp);
+  cmd.setMat(255);
+  reference.cmdList.push_back(cmd);
+}
+
+static bool same(double a, double b)
+{
+  return fabs(a - b) <= 1e-9 * max(fabs(a), fabs(b));
+}
+
+static bool compare(const string& name, const libDRAMPower& chunked, const libDRAMPower& reference)
+{
+  const MemoryPowerModel::Energy& c = chunked.getEnergy();
+  const MemoryPowerModel::Energy& r = reference.getEnergy();
+
+  bool match = same(c.window_energy, r.window_energy) &&
+               same(c.total_energy, r.total_energy) &&
+               same(c.act_energy, r.act_energy) &&
+               same(c.pre_energy, r.pre_energy) &&
+               same(c.read_energy, r.read_energy) &&
+               same(c.act_stdby_energy, r.act_stdby_energy) &&
+               same(c.pre_stdby_energy, r.pre_stdby_energy);
+
+  cout << name << " Total Energy: " << c.window_energy << " pJ";
+  if (!match)
+    cout << ", expected " << r.window_energy << " pJ";
+  cout << endl;
+  return match;
+}
+
+int main(int argc, char* argv[])
+{
+  assert(argc == 2);
+  //Setup of DRAMPower for your simulation
+  string filename;
+  //type path to memspec file
+  filename = argv[1];
+  //Parsing the Memspec specification of found in memspec folder
+#if USE_XERCES
+  MemorySpecification memSpec(MemSpecParser::getMemSpecFromXML(filename));
+#else
+  MemorySpecification memSpec;
+#endif
+  libDRAMPower chunked = libDRAMPower(memSpec, 0);
+  libDRAMPower reference = libDRAMPower(memSpec, 0);
+
+  // Each access takes 5 commands and a window holds 2500 accesses, so that
+  // every window is evaluated in a few chunks, which end at different
+  // commands of the accesses
+  const int64_t accessCycles = 40;
+  const int64_t windowSize = 100000;
+  const int windows = 4;
+  const int banks = 8;
+
+  ios_base::fmtflags flags = cout.flags();
+  streamsize precision = cout.precision();
+  cout.precision(2);
+  cout << fixed;
+
+  bool match = true;
+  int i = 0;
+  // The accesses do not start at a window boundary, so that the auto
+  // precharges of the last RDA of a window spill into the next one
+  for (int64_t t = 17; t < windows * windowSize + windowSize / 2; t += accessCycles) {
+    if (t >= (i + 1) * windowSize) {
+      chunked.calcWindowEnergy(++i * windowSize);
+      reference.calcWindowEnergy(i * windowSize);
+      match &= compare("Window " + to_string(i), chunked, reference);
+    }
+
+    int bank = static_cast<int>(t / accessCycles % banks);
+    push(chunked, reference, MemCommand::ACT, bank, t, t);
+    // Sector reads issued together, the later sectors first
+    push(chunked, reference, MemCommand::RD, bank, t + 18, t + 10);
+    push(chunked, reference, MemCommand::RD, bank, t + 14, t + 10);
+    push(chunked, reference, MemCommand::RD, bank, t + 10, t + 10);
+    push(chunked, reference, MemCommand::RDA, bank, t + 22, t + 22);
+  }
+
+  chunked.calcEnergy();
+  reference.calcEnergy();
+  match &= compare("Window " + to_string(++i), chunked, reference);
+  cout << "Total Trace Energy: " << chunked.getEnergy().total_energy << " pJ" << endl;
+
+  cout.flags(flags);
+  cout.precision(precision);
+
+  if (!match) {
+    cerr << "Chunked and unchunked energies differ" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2014, TU Delft, TU Eindhoven and TU Kaiserslautern
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Regression test for CommandAnalysis::getCommands. The commands are split
+// in windows whose ends fall between RDA/WRA commands and their auto
+// precharges, and include commands with equal timestamps (also an auto
+// precharge and an ACT to the same bank) given out of time order. The
+// counters must match the ones of a single call with all the commands.
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CommandAnalysis.h"
+#if USE_XERCES
+    #include "xmlparser/MemSpecParser.h"
+#endif
+
+
+using namespace std;
+using namespace DRAMPower;
+
+static bool check(const string& what, int64_t value, int64_t expected)
+{
+  if (value == expected)
+    return true;
+  cerr << what << ": " << value << ", expected " << expected << endl;
+  return false;
+}
+
+static bool compare(const CommandAnalysis& windowed, const CommandAnalysis& reference)
+{
+  bool match = true;
+  for (size_t b = 0; b < reference.numberofactsBanks.size(); b++) {
+    string bank = " of bank " + to_string(b);
+    match &= check("ACTs" + bank, windowed.numberofactsBanks[b], reference.numberofactsBanks[b]);
+    match &= check("PREs" + bank, windowed.numberofpresBanks[b], reference.numberofpresBanks[b]);
+    match &= check("RDs" + bank, windowed.numberofreadsBanks[b], reference.numberofreadsBanks[b]);
+    match &= check("WRs" + bank, windowed.numberofwritesBanks[b], reference.numberofwritesBanks[b]);
+    match &= check("Active cycles" + bank, windowed.actcyclesBanks[b], reference.actcyclesBanks[b]);
+  }
+  match &= check("Active cycles", windowed.actcycles, reference.actcycles);
+  match &= check("Precharged cycles", windowed.precycles, reference.precycles);
+  match &= check("Active idle cycles", windowed.idlecycles_act, reference.idlecycles_act);
+  match &= check("Precharged idle cycles", windowed.idlecycles_pre, reference.idlecycles_pre);
+  return match;
+}
+
+int main(int argc, char* argv[])
+{
+  assert(argc == 2);
+  //Setup of DRAMPower for your simulation
+  string filename;
+  //type path to memspec file
+  filename = argv[1];
+  //Parsing the Memspec specification of found in memspec folder
+#if USE_XERCES
+  MemorySpecification memSpec(MemSpecParser::getMemSpecFromXML(filename));
+#else
+  MemorySpecification memSpec;
+#endif
+
+  // When the auto precharges of the commands below are due
+  int64_t RAS = memSpec.memTimingSpec.RAS;
+  int64_t wraPre = max(40 + MemCommand(MemCommand::WRA, 1, 40).getPrechargeOffset(memSpec, MemCommand::WRA),
+                       10 + RAS);
+  int64_t rdaPre = max(95 + MemCommand(MemCommand::RDA, 0, 95).getPrechargeOffset(memSpec, MemCommand::RDA),
+                       10 + RAS);
+  int64_t lateWraPre = max(190 + MemCommand(MemCommand::WRA, 1, 190).getPrechargeOffset(memSpec, MemCommand::WRA),
+                           wraPre + RAS);
+  assert(wraPre < 70 && rdaPre > 100 && rdaPre < 110 && lateWraPre > 200);
+
+  vector<vector<MemCommand>> windows = {
+    {
+      MemCommand(MemCommand::ACT, 0, 10),
+      MemCommand(MemCommand::ACT, 1, 10),
+      MemCommand(MemCommand::WRA, 1, 40),
+      // Issued when the auto precharge of the WRA is, which comes first
+      MemCommand(MemCommand::ACT, 1, wraPre),
+      // Its precharge is in the next window
+      MemCommand(MemCommand::RDA, 0, 95),
+      // Out of time order
+      MemCommand(MemCommand::RD, 1, 80),
+      MemCommand(MemCommand::RD, 1, 80)
+    }, {
+      MemCommand(MemCommand::ACT, 0, 110),
+      MemCommand(MemCommand::WR, 0, 130),
+      MemCommand(MemCommand::RD, 0, 120),
+      MemCommand(MemCommand::PRE, 0, 150),
+      // Its precharge is in the last window, and so is the ACT issued
+      // when it is due
+      MemCommand(MemCommand::WRA, 1, 190),
+      MemCommand(MemCommand::ACT, 1, lateWraPre),
+      // At the end of the window, so it belongs to it
+      MemCommand(MemCommand::ACT, 2, 200)
+    }, {
+      MemCommand(MemCommand::RD, 2, 220),
+      MemCommand(MemCommand::PRE, 2, 260)
+    }
+  };
+  const int64_t windowSize = 100;
+
+  CommandAnalysis windowed(memSpec);
+  CommandAnalysis reference(memSpec);
+  vector<MemCommand> all;
+  bool match = true;
+
+  for (size_t i = 0; i < windows.size(); i++) {
+    all.insert(all.end(), windows[i].begin(), windows[i].end());
+    bool last = i + 1 == windows.size();
+    windowed.getCommands(windows[i], last, static_cast<int64_t>(i + 1) * windowSize);
+
+    if (i == 0) {
+      match &= check("ACTs of bank 1 in window 1", windowed.numberofactsBanks[1], 2);
+      match &= check("PREs of bank 0 in window 1", windowed.numberofpresBanks[0], 0);
+      match &= check("PREs of bank 1 in window 1", windowed.numberofpresBanks[1], 1);
+      match &= check("RDs of bank 1 in window 1", windowed.numberofreadsBanks[1], 2);
+    } else if (i == 1) {
+      match &= check("PREs of bank 0 in window 2", windowed.numberofpresBanks[0], 2);
+      match &= check("PREs of bank 1 in window 2", windowed.numberofpresBanks[1], 1);
+      match &= check("ACTs of bank 2 in window 2", windowed.numberofactsBanks[2], 1);
+    } else {
+      match &= check("PREs of bank 1 in window 3", windowed.numberofpresBanks[1], 2);
+      match &= check("ACTs of bank 1 in window 3", windowed.numberofactsBanks[1], 3);
+      match &= check("PREs of bank 2 in window 3", windowed.numberofpresBanks[2], 1);
+    }
+  }
+
+  reference.getCommands(all, true);
+  match &= compare(windowed, reference);
+
+  if (!match) {
+    cerr << "Windowed and single getCommands calls differ" << endl;
+    return 1;
+  }
+  cout << "Windowed and single getCommands calls match" << endl;
+  return 0;
+}
@@ -5,6 +5,7 @@ import os
 import fnmatch
 import tempfile
 import gzip
+import struct
 import multiprocessing
 
 devnull = None
@@ -309,6 +310,80 @@ class TestOutput(TestUsingBuildResult):
                                           '-m', 'memspecs/MICRON_1Gb_DDR2-800_16bit_H.xml',
                                           '-c', 'test/data/warnings.trace'], stdout=devnull, stderr=devnull), 0)
 
+    def write_binary_trace(self, textTrace):
+        """ Converts a text command trace to a binary command trace as written by ramulator
+            (ramulator/src/CmdTraceFormat.h) """
+        names = []
+        records = []
+        last = 0
+        with open(textTrace, 'r') as f:
+            for line in f:
+                fields = line.strip().split(',')
+                if len(fields) < 2:
+                    continue
+                if fields[1] not in names:
+                    names.append(fields[1])
+                timestamp = int(fields[0])
+                bank = int(fields[2]) if len(fields) > 2 else 0
+                sectors = int(fields[3]) if len(fields) > 3 else 0
+                records.append(struct.pack('<IBBH', timestamp - last, names.index(fields[1]), sectors, bank))
+                last = timestamp
+
+        binaryHandle, binaryTrace = tempfile.mkstemp()
+        os.close(binaryHandle)
+        self.tempFiles.append(binaryTrace)
+        with open(binaryTrace, 'wb') as f:
+            f.write(struct.pack('<8sIIII', b'RAMCMDBN', 1, 8, len(names), 0))
+            for name in names:
+                f.write(struct.pack('16s', name.encode()))
+            for record in records:
+                f.write(record)
+        return binaryTrace
+
+    def run_and_get_output(self, cmd):
+        with open(self.tempFileName, 'w') as f:
+            self.assertEqual(subprocess.call(cmd, stdout=f), 0)
+        return self.getFilteredOutput(self.tempFileName)
+
+    def test_binary_trace_matches_text_trace(self):
+        """ drampower output for a binary command trace should be equal to the one for the same commands in a text trace """
+        self.maxDiff = None  # Show full diff on error.
+        textTrace = 'test/data/LPDDR2-1066_short.commands.trace'
+        memspec = 'memspecs/MICRON_2Gb_LPDDR2-1066-S4_16bit_A.xml'
+        text = self.run_and_get_output(['./drampower', '-m', memspec, '-c', textTrace])
+        binary = self.run_and_get_output(['./drampower', '-m', memspec, '-c', self.write_binary_trace(textTrace)])
+        self.assertListEqual(binary, text)
+
+    def test_multiple_traces(self):
+        """ drampower output for several command traces should be the output for each trace in order, followed by their total energy and power """
+        self.maxDiff = None  # Show full diff on error.
+        traces = [self.get_LPDDR2_1066_trace_file(), 'test/data/LPDDR2-1066_short.commands.trace']
+        memspec = 'memspecs/MICRON_2Gb_LPDDR2-1066-S4_16bit_A.xml'
+        single = []
+        for trace in traces:
+            single.append(self.run_and_get_output(['./drampower', '-m', memspec, '-c', trace]))
+        combined = self.run_and_get_output(['./drampower', '-m', memspec, '-c'] + traces + ['-j', '2'])
+
+        self.assertListEqual(combined[:-3], single[0] + single[1])
+
+        def value(lines, prefix):
+            return sum(float(x.split(':')[1].split()[0]) for x in lines if x.startswith(prefix))
+        totals = combined[-3:]
+        self.assertAlmostEqual(value(totals, 'Total Energy of All Traces'),
+                               value(single[0] + single[1], 'Total Trace Energy'), delta=0.02)
+        self.assertAlmostEqual(value(totals, 'Average Power of All Traces'),
+                               value(single[0] + single[1], 'Average Power'), delta=0.02)
+
+    def test_malformed_trace(self):
+        """ running drampower with a malformed command trace line should fail and report the line """
+        with open(self.tempFileName, 'w') as f:
+            f.write('0,ACT,0\n10,RD\n18,PRE,x\n')
+        p = subprocess.Popen(['./drampower', '-m', 'memspecs/MICRON_1Gb_DDR2-800_16bit_H.xml', '-c', self.tempFileName],
+                             stdout=devnull, stderr=subprocess.PIPE, universal_newlines=True)
+        err = p.communicate()[1]
+        self.assertNotEqual(p.returncode, 0)
+        self.assertIn('Malformed command trace line: 18,PRE,x', err)
+
 
 class TestLibDRAMPower(TestUsingBuildResult):
     testPath = 'test/libdrampowertest'
@@ -364,6 +439,18 @@ class TestLibDRAMPower(TestUsingBuildResult):
 
         self.assertEqual(drampower, libdrampower)
 
+    def test_chunked_commands(self):
+        """ libdrampower energies should not depend on how many commands are buffered before they are evaluated """
+        self.buildLibDRAMPowerExecutables()
+        self.assertEqual(subprocess.call([TestLibDRAMPower.testPath + '/chunk_test', 'memspecs/MICRON_1Gb_DDR2-1066_16bit_H.xml'],
+                                         stdout=devnull), 0)
+
+    def test_getcommands_windows(self):
+        """ CommandAnalysis counters should not depend on the windows the commands are evaluated in """
+        self.buildLibDRAMPowerExecutables()
+        self.assertEqual(subprocess.call([TestLibDRAMPower.testPath + '/getcommands_test', 'memspecs/MICRON_1Gb_DDR2-1066_16bit_H.xml'],
+                                         stdout=devnull), 0)
+
 class TestClean(unittest.TestCase):
     def setUp(self):
         self.assertEqual(subprocess.call(['make', '-f', 'Makefile', 'clean'], stdout=devnull), 0)
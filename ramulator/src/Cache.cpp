@@ -1,4 +1,5 @@
 #include "Cache.h"
+#include "Checkpoint.h"
 
 #ifndef DEBUG_CACHE
 #define debug(...)
@@ -17,8 +18,9 @@ Cache::Cache(int id, int size, int assoc, int block_size,
     int mshr_entry_num, Level level,
     std::shared_ptr<CacheSystem> cachesys, const Config &configs):
     level(level), cachesys(cachesys), higher_cache(0),
-    lower_cache(nullptr), size(size), assoc(assoc),
-    block_size(block_size), mshr_entry_num(mshr_entry_num), sp(configs, id)
+    lower_cache(nullptr), sp(configs, id), size(size), assoc(assoc),
+    block_size(block_size), mshr_entry_num(mshr_entry_num),
+    mshr_entries(mshr_entry_num)
 {
   coreid = id;
 
@@ -69,10 +71,29 @@ Cache::Cache(int id, int size, int assoc, int block_size,
   debug("index_mask 0x%x", index_mask);
   debug("tag_offset %d", tag_offset);
 
+  CacheSet::PolicyType policy = CacheSet::PolicyType::MRU;
+  if (configs.contains("cache_replacement")) {
+    auto name = name_to_policy.find(configs["cache_replacement"]);
+    if (name == name_to_policy.end()) {
+      std::cerr << "Unknown cache_replacement policy: " << configs["cache_replacement"] << std::endl;
+      exit(1);
+    }
+    policy = name->second;
+  }
+  if (policy == CacheSet::PolicyType::DRRIP)
+    dueling = std::make_shared<CacheSet::DuelingMonitor>();
+
   // Initialize cache sets
   cache_sets = std::vector<CacheSet>();
-  for (int i = 0 ; i < block_num ; i++)
-    cache_sets.push_back(CacheSet(assoc, CacheSet::PolicyType::MRU));
+  for (int i = 0 ; i < block_num ; i++) {
+    // DRRIP dedicates one set in DUELING_SETS to each of SRRIP and BRRIP
+    CacheSet::DuelingRole role = CacheSet::DuelingRole::Follower;
+    if (i % DUELING_SETS == 0)
+      role = CacheSet::DuelingRole::SRRIPLeader;
+    else if (i % DUELING_SETS == DUELING_SETS / 2)
+      role = CacheSet::DuelingRole::BRRIPLeader;
+    cache_sets.push_back(CacheSet(assoc, policy, dueling, role));
+  }
 
   printf("coreid:%d\n",coreid);
 
@@ -232,6 +253,11 @@ ulong Cache::findActualAccess(const Request& req)
 }
 
 bool Cache::send(Request req) {
+  if (cachesys->functional) {
+    warm(req);
+    return true;
+  }
+
   debug("level %d req.addr %lx req.type %d, index %d, tag %ld, sectors %ld, type %d",
       int(level), req.addr, int(req.type), get_index(req.addr),
       get_tag(req.addr), req.sector_bits[int(level)], req.type);
@@ -287,13 +313,7 @@ bool Cache::send(Request req) {
   }
 
   // Extract stuff from request
-  ulong level_sector_bits = 0UL;
-
-  if(sectoredDRAM || DGMS)
-    level_sector_bits = is_first_level ? req.sector_bits[0] : is_second_level ? req.sector_bits[1] : req.sector_bits[2];
-
-  if(partialActivationDRAM)
-    level_sector_bits = (1 << (64/sector_size)) - 1;
+  ulong level_sector_bits = get_level_sector_bits(req);
 
   //assert(!((~level_sector_bits) & findActualAccess(req)) && "Request accesses sectors it does not bring...");
 
@@ -301,6 +321,9 @@ bool Cache::send(Request req) {
   long block_num = req.addr >> index_offset;
 
   bool is_valid = set.isValid(tag);
+
+  if (is_valid && req.type != Request::Type::PREFETCH)
+    set.rereference(tag);
     
   // block missed in cache
   // this does not cover sector misses
@@ -310,33 +333,30 @@ bool Cache::send(Request req) {
     ulong remaining_sector_bits = level_sector_bits;
     // Check if any MSHR is trying to bring this block in
     bool any_mshr_match = false;
-    for (int i = 0 ; i < mshr_entries.size() ; i++)
+    for (int i = mshr_entries.find(block_num) ; i != -1 ; i = mshr_entries[i].next)
     {
       // Found matching MSHR
-      if (mshr_entries[i].tag == block_num)
+      any_mshr_match = true;
+      mshr_entries[i].dirty |= req.type == Request::Type::WRITE;
+      if (req.type == Request::Type::WRITE)
       {
-        any_mshr_match = true;
-        mshr_entries[i].dirty |= req.type == Request::Type::WRITE;
-        if (req.type == Request::Type::WRITE)
-        {
-          assert(!(partialActivationDRAM || sectoredDRAM || DGMS) || findActualAccess(req));
-          mshr_entries[i].will_be_dirty_sectors |= findActualAccess(req);
-        }
-        mshr_entries[i].will_be_used_sectors |= findActualAccess(req);
-        // MSHR fully covers our sector bits, in this case we are fine
-        if (!((~mshr_entries[i].sector_bits) & level_sector_bits))
-        {
-          cache_mshr_sector_hit++;
-          debug("cache sector hit mshr");
-          //req.cache_hit = true;
-          //req.hit_level = int(level);
-          //cachesys->hit_list.push_back(
-            //make_pair(cachesys->clk + latency[int(level)], req));
-          return true;
-        }
-        else
-          remaining_sector_bits &= ~(mshr_entries[i].sector_bits);
+        assert(!(partialActivationDRAM || sectoredDRAM || DGMS) || findActualAccess(req));
+        mshr_entries[i].will_be_dirty_sectors |= findActualAccess(req);
+      }
+      mshr_entries[i].will_be_used_sectors |= findActualAccess(req);
+      // MSHR fully covers our sector bits, in this case we are fine
+      if (!((~mshr_entries[i].sector_bits) & level_sector_bits))
+      {
+        cache_mshr_sector_hit++;
+        debug("cache sector hit mshr");
+        //req.cache_hit = true;
+        //req.hit_level = int(level);
+        //cachesys->hit_list.push_back(
+          //make_pair(cachesys->clk + latency[int(level)], req));
+        return true;
       }
+      else
+        remaining_sector_bits &= ~(mshr_entries[i].sector_bits);
     }
 
     // No MSHR fully covers our block, but collectively some of them do
@@ -368,13 +388,12 @@ bool Cache::send(Request req) {
         // When WRITEs set the sector bits required by this request,
         // the MSHRs won't actually "trigger" matches in the wait list
         // so we need to count these as hits       
-        cachesys->hit_list.push_back(
-          make_pair(cachesys->clk + latency[int(level)], req));
+        cachesys->callback_after(latency[int(level)], std::move(req));
         return true;
       }
 
 
-      if (mshr_entries.size() == mshr_entry_num) 
+      if (mshr_entries.full()) 
       {
         cache_mshr_unavailable++;
         debug("There is an MSHR to same tag, but no mshr entries available for us to bring additional sectors");
@@ -395,11 +414,11 @@ bool Cache::send(Request req) {
         req.sector_bits[0] |= sp_sector_bits; // These will be available to the processor after they are brought
       }
 
-      mshr_entry_type metr = {block_num, req.sector_bits[int(level) + 1], false, 0UL, 0UL};
+      mshr_entry_type metr = {block_num, req.sector_bits[int(level) + 1], false, 0UL, 0UL, -1};
 
       assert(!(sectoredDRAM || DGMS) || req.sector_bits[int(level) + 1] != 0 && "Cannot demand zero sectors from the lower level cache"); 
 
-      mshr_entries.push_back(metr);
+      mshr_entries.allocate(metr);
 
       debug("cache sector mshr miss");
 
@@ -420,8 +439,7 @@ bool Cache::send(Request req) {
           }
         }        
       } else {
-        cachesys->wait_list.push_back(
-            make_pair(cachesys->clk + latency[int(level)], req));
+        cachesys->send_after(latency[int(level)], req);
       } 
 
       if(prefetcher && req.type != Request::Type::PREFETCH)
@@ -432,23 +450,17 @@ bool Cache::send(Request req) {
     // No need to allocate a new MSHR, we modify the MSHRs sector bits instead
     else if (any_mshr_match && req.type == Request::Type::WRITE)
     {
-      for (int i = 0 ; i < mshr_entries.size() ; i++)
-      {
-        if (mshr_entries[i].tag == block_num)
-        {
-          set.insertSectors(tag, findActualAccess(req));
-          set.access(tag, findActualAccess(req), true);
-          //mshr_entries[i].sector_bits |= remaining_sector_bits;
-          mshr_entries[i].dirty = true;
-          //assert(findActualAccess(req));
-          //mshr_entries[i].will_be_dirty_sectors = findActualAccess(req); // needed?
-          cache_mshr_sector_hit++;
-          debug("cache sector mshr hit (for writes that missed in mshrs)");
-          return true;
-        }
-      }
-      assert(false);
-      return false;
+      int i = mshr_entries.find(block_num);
+      assert(i != -1);
+      set.insertSectors(tag, findActualAccess(req));
+      set.access(tag, findActualAccess(req), true);
+      //mshr_entries[i].sector_bits |= remaining_sector_bits;
+      mshr_entries[i].dirty = true;
+      //assert(findActualAccess(req));
+      //mshr_entries[i].will_be_dirty_sectors = findActualAccess(req); // needed?
+      cache_mshr_sector_hit++;
+      debug("cache sector mshr hit (for writes that missed in mshrs)");
+      return true;
     }
     // We need to allocate a new MSHR, and potentially a new cache block
     else
@@ -461,13 +473,13 @@ bool Cache::send(Request req) {
         // also make it busy s.t. it won't get evicted
         if (!set.isValid(victim_tag) && !set.isBusy(victim_tag))
         {
-          if (mshr_entries.size() == mshr_entry_num) 
+          if (mshr_entries.full()) 
           {
             cache_mshr_unavailable++;
             debug("no mshr entry available");
             return false;
           }
-          set.insert(victim_tag, tag, req.inst_addr, 0UL);
+          set.insert(victim_tag, tag, req.inst_addr, req.coreid, 0UL);
           // dumpSet(req.addr);
           set.makeBusy(tag);
         }
@@ -480,7 +492,7 @@ bool Cache::send(Request req) {
           {
             assert(set.isValid(victim_tag) && "an invalid block turned out to be evictable");
 
-            if (mshr_entries.size() == mshr_entry_num) 
+            if (mshr_entries.full()) 
             {
               cache_mshr_unavailable++;
               debug("no mshr entry available");
@@ -488,7 +500,7 @@ bool Cache::send(Request req) {
             }
             debug("cache evict a block to allocate new block");
             this->evict(victim_addr);
-            set.insert(victim_tag, tag, req.inst_addr, 0UL);
+            set.insert(victim_tag, tag, req.inst_addr, req.coreid, 0UL);
             // dumpSet(req.addr);
             set.makeBusy(tag);
           }
@@ -509,14 +521,10 @@ bool Cache::send(Request req) {
         }
         dumpSet(req.addr);
         debug("This request's MSHR tag: 0x%lx", req.addr>>index_offset);
-        for (int i = 0 ; i < mshr_entries.size() ; i++)
-        {
-          debug("MSHR%d waiting on address 0x%lx to bring sector bits %ld", i, mshr_entries[i].tag, mshr_entries[i].sector_bits);
-        }
         assert(false && "No MSHRs match the block, but the block is busy");
       }
       // We need to allocate a new MSHR
-      if (mshr_entries.size() == mshr_entry_num) 
+      if (mshr_entries.full()) 
       {
         cache_mshr_unavailable++;
         debug("no mshr entry available");
@@ -540,8 +548,8 @@ bool Cache::send(Request req) {
           //req.sector_bits[int(level) + 1] |= sp_sector_bits;
         }
 
-        mshr_entry_type metr = {block_num, remaining_sector_bits, dirty, 0UL, remaining_sector_bits & findActualAccess(req)};
-        mshr_entries.push_back(metr);
+        mshr_entry_type metr = {block_num, remaining_sector_bits, dirty, 0UL, remaining_sector_bits & findActualAccess(req), -1};
+        mshr_entries.allocate(metr);
         assert(!set.isValid(tag) && set.isBusy(tag) && "Expected block to be not valid and busy");
 
         // The block is not filled in, that's why we're here
@@ -582,8 +590,7 @@ bool Cache::send(Request req) {
             }
           }          
         } else {
-          cachesys->wait_list.push_back(
-              make_pair(cachesys->clk + latency[int(level)], req));
+          cachesys->send_after(latency[int(level)], req);
         }
 
         if(prefetcher && req.type != Request::Type::PREFETCH)
@@ -623,8 +630,7 @@ bool Cache::send(Request req) {
       //for (int st = int(level) ; st >= 0 ; st--)
         //req.sector_bits[st] = findActualAccess(req);
 
-      cachesys->hit_list.push_back(
-          make_pair(cachesys->clk + latency[int(level)], req));
+      cachesys->callback_after(latency[int(level)], req);
 
       debug("hit, update timestamp %ld", cachesys->clk);
       debug("hit finish time %ld",
@@ -662,29 +668,26 @@ bool Cache::send(Request req) {
         ulong remaining_sector_bits = level_sector_bits;
         // Check if any MSHR is trying to bring this block in
         bool any_mshr_match = false;
-        for (int i = 0 ; i < mshr_entries.size() ; i++)
+        for (int i = mshr_entries.find(block_num) ; i != -1 ; i = mshr_entries[i].next)
         {
           // Found matching MSHR
-          if (mshr_entries[i].tag == block_num)
-          {
-            any_mshr_match = true;
+          any_mshr_match = true;
 
-            // MSHR fully covers our sector bits, in this case we are fine
-            if (!((~mshr_entries[i].sector_bits) & level_sector_bits))
-            {
-              set.insertSectors(tag, findActualAccess(req));
-              set.access(tag, findActualAccess(req), false);
-              cache_mshr_sector_hit++;
-              //req.cache_hit = true;
-              //req.hit_level = int(level);
-              //cachesys->hit_list.push_back(
-                //make_pair(cachesys->clk + latency[int(level)], req));
-              return true;
-            }
-            else
-              remaining_sector_bits &= ~(mshr_entries[i].sector_bits);
+          // MSHR fully covers our sector bits, in this case we are fine
+          if (!((~mshr_entries[i].sector_bits) & level_sector_bits))
+          {
+            set.insertSectors(tag, findActualAccess(req));
+            set.access(tag, findActualAccess(req), false);
+            cache_mshr_sector_hit++;
+            //req.cache_hit = true;
+            //req.hit_level = int(level);
+            //cachesys->hit_list.push_back(
+              //make_pair(cachesys->clk + latency[int(level)], req));
+            return true;
           }
-        }        
+          else
+            remaining_sector_bits &= ~(mshr_entries[i].sector_bits);
+        }
 
         // 2) No MSHR fully covers our block, but collectively some of them do
         if (remaining_sector_bits == 0)
@@ -700,7 +703,7 @@ bool Cache::send(Request req) {
         }
 
         // 3) Allocate new MSHR
-        if (mshr_entries.size() == mshr_entry_num) 
+        if (mshr_entries.full()) 
         {
           cache_mshr_unavailable++;
           debug("no mshr entry available");
@@ -723,8 +726,7 @@ bool Cache::send(Request req) {
             // When WRITEs set the sector bits required by this request,
             // the MSHRs won't actually "trigger" matches in the wait list
             // so we need to count these as hits
-            cachesys->hit_list.push_back(
-              make_pair(cachesys->clk + latency[int(level)], req));
+            cachesys->callback_after(latency[int(level)], std::move(req));
             return true;
           }
 
@@ -743,8 +745,8 @@ bool Cache::send(Request req) {
           // The block is not filled in, that's why we're here
           req.sector_bits[int(level) + 1] = filtered_sector_bits;
           // Create a new MSHR entry 
-          mshr_entry_type metr = {block_num, req.sector_bits[int(level) + 1], false, 0UL, 0UL};
-          mshr_entries.push_back(metr);
+          mshr_entry_type metr = {block_num, req.sector_bits[int(level) + 1], false, 0UL, 0UL, -1};
+          mshr_entries.allocate(metr);
           set.makeBusy(tag);
           assert(set.isValid(tag) && "Expected block to be valid");
 
@@ -767,8 +769,7 @@ bool Cache::send(Request req) {
               }
             }
           } else {
-            cachesys->wait_list.push_back(
-                make_pair(cachesys->clk + latency[int(level)], req));
+            cachesys->send_after(latency[int(level)], std::move(req));
           }
           return true;
         }
@@ -777,6 +778,84 @@ bool Cache::send(Request req) {
   }
 }
 
+void Cache::warm(Request req) {
+  ulong level_sector_bits = get_level_sector_bits(req);
+  ulong actual_access = findActualAccess(req);
+
+  int set_idx = (req.addr >> index_offset) & index_mask;
+  CacheSet& set = cache_sets[set_idx];
+  long tag = req.addr >> tag_offset;
+
+  if (set.isValid(tag))
+  {
+    if (req.type != Request::Type::PREFETCH)
+      set.rereference(tag);
+
+    if (set.areSectorsValid(tag, level_sector_bits))
+    {
+      if (req.type == Request::Type::PREFETCH)
+        return;
+      set.access(tag, actual_access & level_sector_bits, req.type == Request::Type::WRITE);
+      if (prefetcher)
+        prefetcher->hit(req.addr, cachesys->clk, level_sector_bits);
+      return;
+    }
+
+    // a write brings its own sectors
+    if (req.type == Request::Type::WRITE)
+    {
+      set.insertSectors(tag, actual_access);
+      set.access(tag, actual_access, true);
+      return;
+    }
+
+    // read sector miss, bring the missing sectors
+    ulong sector_bits = set.findMissingSectors(tag, level_sector_bits);
+    if (is_first_level && spatial_predictor)
+      sector_bits |= sp.predict(req.inst_addr, req.addr);
+    req.sector_bits[int(level) + 1] = sector_bits;
+    if (!is_last_level)
+      lower_cache->warm(req);
+
+    set.insertSectors(tag, sector_bits);
+    set.access(tag, actual_access & sector_bits, false);
+    return;
+  }
+
+  // block miss, nothing is in flight so any victim can be evicted
+  long victim_tag = set.findVictim();
+  if (set.isValid(victim_tag))
+  {
+    cache_eviction++;
+    evictBlock((victim_tag << tag_offset) | (set_idx << index_offset));
+  }
+  set.insert(victim_tag, tag, req.inst_addr, req.coreid, 0UL);
+
+  ulong sector_bits = level_sector_bits;
+  if (is_first_level && spatial_predictor)
+    sector_bits |= sp.predict(req.inst_addr, req.addr);
+  req.sector_bits[int(level) + 1] = sector_bits;
+
+  bool dirty = req.type == Request::Type::WRITE;
+  // claim ownership by reading the block, as in send()
+  if (req.type != Request::Type::PREFETCH)
+    req.type = Request::Type::READ;
+  if (!is_last_level)
+    lower_cache->warm(req);
+
+  set.validate(tag);
+  set.insertSectors(tag, sector_bits);
+  set.access(tag, actual_access & sector_bits, false);
+  if (dirty)
+  {
+    set.makeDirty(tag);
+    set.access(tag, actual_access & sector_bits, true);
+  }
+
+  if (prefetcher && req.type != Request::Type::PREFETCH)
+    prefetcher->miss(req.addr, cachesys->clk, sector_bits);
+}
+
 bool Cache::evictable(const long victim_addr) 
 {
   bool evictable_higher_cache = true;
@@ -933,6 +1012,8 @@ void Cache::evict(const long victim_addr) {
   // We will use this to update the copy at the upper level and calculate some stats
   ulong all_used_sectors = getUsedSectors(victim_addr);
   ulong dirty_sectors = getDirtySectors(victim_addr);
+  // write-backs are attributed to the core that brought the block in
+  int owner = set.getOwner(tag);
   //printf("0x%lx\n",all_used_sectors);
   //assert(!sectoredDRAM || all_used_sectors && "Evicting a line with no used sectors...");
   // assert(!(sectoredDRAM || DGMS) || all_used_sectors && "Evicting a line with no used sectors...");
@@ -947,9 +1028,9 @@ void Cache::evict(const long victim_addr) {
 
     assert(!(sectoredDRAM || partialActivationDRAM || DGMS) || dirty_sectors && "Writing back a dirty cache block with no dirty sectors");
     //assert(false && "Does this work?");
-    Request write_req(victim_addr, Request::Type::WRITE);
+    Request write_req(victim_addr, Request::Type::WRITE, owner);
     write_req.sector_bits[3] = dirty_sectors;
-    cachesys->wait_list.push_back(make_pair(cachesys->clk + latency[int(level)], write_req));
+    cachesys->send_after(latency[int(level)], std::move(write_req));
   }
   // If not LLC, update the cache line in the lower level
   // Evictblock already updates the lower level cache
@@ -1078,69 +1159,54 @@ void Cache::callback(Request& req) {
   CacheSet& set = cache_sets[set_idx];
 
   int mshrs_to_remove = 0;
-  int remove_indices[mshr_entry_num];
 
   bool any_match = false;
 
-  for (int i = 0 ; i < mshr_entries.size() ; i++)
+  int first_mshr = mshr_entries.find(block_num);
+  for (int i = first_mshr ; i != -1 ; i = mshr_entries[i].next)
   {
-    debug("MSHR%d waiting on address 0x%lx to bring sector bits %ld", i, mshr_entries[i].tag, mshr_entries[i].sector_bits);
     // Found matching MSHR
-    if (mshr_entries[i].tag == block_num)
+    debug("mshr_entries[%d].sector_bits:%ld req.sector_bits:%ld", i, mshr_entries[i].sector_bits, req.sector_bits[int(level) + 1]);
+    mshr_entries[i].sector_bits &= ~req.sector_bits[int(level) + 1];
+    /*
+    // The request brought the sectors the MSHR asked for completely 
+    if (mshr_entries[i].sector_bits == req.sector_bits[int(level) + 1])
     {
-      debug("mshr_entries[%d].sector_bits:%ld req.sector_bits:%ld", i, mshr_entries[i].sector_bits, req.sector_bits[int(level) + 1]);
-      mshr_entries[i].sector_bits &= ~req.sector_bits[int(level) + 1];
-      /*
-      // The request brought the sectors the MSHR asked for completely 
-      if (mshr_entries[i].sector_bits == req.sector_bits[int(level) + 1])
-      {
 
-        // TODO: bug: WRITE misses update the cache block's state but forget about MSHRs
+      // TODO: bug: WRITE misses update the cache block's state but forget about MSHRs
 
-      }
-      */
-
-      if (mshr_entries[i].sector_bits == 0UL)
-      {
-        assert(set.isBusy(tag) && "MSHR brought data to an idle block, which should never happen");
+    }
+    */
 
-        any_match = true;
-        bool other_match = false;
+    if (mshr_entries[i].sector_bits == 0UL)
+    {
+      assert(set.isBusy(tag) && "MSHR brought data to an idle block, which should never happen");
 
-        for (int j = 0 ; j < mshr_entries.size() ; j++)
-        {
-          if (j == i) continue;
-          
-          if (mshr_entries[j].tag == mshr_entries[i].tag)
-          {
-            other_match = true;
-            break;
-          }
-        }
+      any_match = true;
+      // MSHRs are removed after the loop, so any other entry of the block is another match
+      bool other_match = first_mshr != i || mshr_entries[i].next != -1;
 
-        // these should happen only when there are no other MSHRs bringing data to this block
-        if (!other_match)
-        {
-          set.makeIdle(tag);
-          set.validate(tag); 
-        }
+      // these should happen only when there are no other MSHRs bringing data to this block
+      if (!other_match)
+      {
+        set.makeIdle(tag);
+        set.validate(tag); 
+      }
 
-        if (mshr_entries[i].dirty)
-        {
-          //printf("MSHR making a set dirty\n");
-          set.makeDirty(tag);
-        }
+      if (mshr_entries[i].dirty)
+      {
+        //printf("MSHR making a set dirty\n");
+        set.makeDirty(tag);
+      }
 
-        assert((set.isValid(tag) || set.isBusy(tag)) && "MSHRs accessing an invalid block"); 
-        set.insertSectors(tag, req.sector_bits[int(level) + 1] | mshr_entries[i].will_be_used_sectors);
-        set.access(tag, (findActualAccess(req) & req.sector_bits[int(level) + 1]) | mshr_entries[i].will_be_used_sectors, false);
-        
-        if (mshr_entries[i].dirty)
-          set.access(tag, mshr_entries[i].will_be_dirty_sectors, true);
+      assert((set.isValid(tag) || set.isBusy(tag)) && "MSHRs accessing an invalid block"); 
+      set.insertSectors(tag, req.sector_bits[int(level) + 1] | mshr_entries[i].will_be_used_sectors);
+      set.access(tag, (findActualAccess(req) & req.sector_bits[int(level) + 1]) | mshr_entries[i].will_be_used_sectors, false);
+      
+      if (mshr_entries[i].dirty)
+        set.access(tag, mshr_entries[i].will_be_dirty_sectors, true);
 
-        remove_indices[mshrs_to_remove] = (i - mshrs_to_remove);
-        mshrs_to_remove++;        
-      }
+      mshrs_to_remove++;        
     }
   }
 
@@ -1151,23 +1217,21 @@ void Cache::callback(Request& req) {
   // as other cores' requests trigger the callback on another private cache? 
   //assert (any_match && "A request brought in sectors requested by no MSHRs");
 
-  // TODO: Remove MSHRs at indices
-  for (int i = 0 ; i < mshrs_to_remove ; i++)
-    mshr_entries.erase(mshr_entries.begin() + remove_indices[i]);
-
-  bool no_more_match = true;
-
-  if (any_match)
+  // Remove the MSHRs that brought all of their sectors
+  for (int i = first_mshr ; mshrs_to_remove > 0 ; )
   {
-    for (int i = 0 ; i < mshr_entries.size() ; i++)
+    int next = mshr_entries[i].next;
+    if (mshr_entries[i].sector_bits == 0UL)
     {
-      if(mshr_entries[i].tag == block_num) // to recover from the side effect when two mshrs get cleared in one go
-      {
-        no_more_match = false;
-      }
-    } 
+      mshr_entries.free(i);
+      mshrs_to_remove--;
+    }
+    i = next;
   }
-  
+
+  // to recover from the side effect when two mshrs get cleared in one go
+  bool no_more_match = mshr_entries.find(block_num) == -1;
+
   if (any_match && no_more_match)
   {
     set.makeIdle(tag);
@@ -1195,6 +1259,33 @@ void Cache::tick() {
 
 }
 
+bool Cache::has_retries() {
+    if(!lower_cache->is_last_level && lower_cache->has_retries())
+        return true;
+
+    return retry_list.size();
+}
+
+bool Cache::is_drained() {
+    return mshr_entries.empty() && retry_list.empty();
+}
+
+void Cache::checkpoint(Checkpoint& ckpt) {
+    assert(!ckpt.saving() || is_drained());
+
+    ckpt.check(cache_sets.size(), "number of cache sets");
+    for (auto& set : cache_sets)
+      set.checkpoint(ckpt);
+    ckpt.check(dueling != nullptr, "DRRIP set dueling");
+    if (dueling)
+      ckpt.io(*dueling);
+    sp.checkpoint(ckpt);
+
+    ckpt.check(prefetcher != nullptr, "stride prefetcher");
+    if (prefetcher)
+      prefetcher->checkpoint(ckpt);
+}
+
 void Cache::gatherFromHigherLevels()
 {
   assert(int(level) == 2 && "gatherFromHigherLevels called on non-LLC cache");
@@ -1212,37 +1303,38 @@ void Cache::gatherFromHigherLevels()
 void CacheSystem::tick() {
   debug("clk %ld", clk);
 
-  //if (clk > 42500)
-    //exit(0);
-
   ++clk;
 
   // Sends ready waiting request to memory
-  auto it = wait_list.begin();
-  while (it != wait_list.end() && clk >= it->first) {
-    if (!send_memory(it->second)) {
-      ++it;
+  wait_list.pop(clk, memory_queue);
+  size_t waiting = 0;
+  for (size_t i = 0; i < memory_queue.size(); i++) {
+    if (!send_memory(memory_queue[i])) {
+      if (waiting != i)
+        memory_queue[waiting] = std::move(memory_queue[i]);
+      waiting++;
     } else {
-
-      debug("complete req: addr %lx", (it->second).addr);
-
-      it = wait_list.erase(it);
+      debug("complete req: addr %lx", memory_queue[i].addr);
     }
   }
+  memory_queue.erase(memory_queue.begin() + waiting, memory_queue.end());
 
   // hit request callback
-  it = hit_list.begin();
-  while (it != hit_list.end()) {
-    if (clk >= it->first) {
-      it->second.callback(it->second);
+  hit_list.pop(clk, due_hits);
+  for (auto& req : due_hits) {
+    req.callback(req);
 
-      debug("finish hit: addr %lx", (it->second).addr);
-
-      it = hit_list.erase(it);
-    } else {
-      ++it;
-    }
+    debug("finish hit: addr %lx", req.addr);
   }
+  due_hits.clear();
+}
+
+long CacheSystem::next_event() {
+  long next_wait = wait_list.next_due(clk);
+  long next_hit = hit_list.next_due(clk);
+  if (next_wait == -1 || next_hit == -1)
+    return std::max(next_wait, next_hit);
+  return std::min(next_wait, next_hit);
 }
 
 } // namespace ramulator
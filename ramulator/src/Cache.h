@@ -9,6 +9,7 @@
 #include "CacheSet.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cassert>
 #include <functional>
@@ -17,10 +18,83 @@
 #include <memory>
 #include <queue>
 #include <list>
+#include <unordered_map>
 
 namespace ramulator
 {
 class CacheSystem;
+class Checkpoint;
+
+// Miss status holding registers. The entries of a block are found through a
+// hash map on the block number and linked in allocation order, free entries
+// are kept in a free list.
+class MSHRFile {
+public:
+  struct Entry
+  {
+    long tag; // block number
+    ulong sector_bits; // sectors that are not brought yet
+    bool dirty;
+    ulong will_be_used_sectors;
+    ulong will_be_dirty_sectors;
+    int next; // the next entry of the same block, -1 for the last one
+  };
+
+  explicit MSHRFile(int capacity) : entries(capacity) {
+    for (int i = capacity - 1; i >= 0; i--)
+      free_entries.push_back(i);
+    first_entry.reserve(capacity);
+  }
+
+  bool full() const {return free_entries.empty();}
+  bool empty() const {return first_entry.empty();}
+
+  // The first entry of a block, -1 if there is none
+  int find(long block) const {
+    auto first = first_entry.find(block);
+    return first == first_entry.end() ? -1 : first->second;
+  }
+
+  Entry& operator[](int i) {return entries[i];}
+
+  void allocate(const Entry& entry) {
+    assert(!full());
+    int i = free_entries.back();
+    free_entries.pop_back();
+    entries[i] = entry;
+    entries[i].next = -1;
+
+    auto first = first_entry.emplace(entry.tag, i);
+    if (!first.second) {
+      int last = first.first->second;
+      while (entries[last].next != -1)
+        last = entries[last].next;
+      entries[last].next = i;
+    }
+  }
+
+  void free(int i) {
+    auto first = first_entry.find(entries[i].tag);
+    assert(first != first_entry.end());
+    if (first->second == i) {
+      if (entries[i].next == -1)
+        first_entry.erase(first);
+      else
+        first->second = entries[i].next;
+    } else {
+      int prev = first->second;
+      while (entries[prev].next != i)
+        prev = entries[prev].next;
+      entries[prev].next = entries[i].next;
+    }
+    free_entries.push_back(i);
+  }
+
+private:
+  std::vector<Entry> entries;
+  std::vector<int> free_entries;
+  std::unordered_map<long, int> first_entry;
+};
 
 class Cache {
 protected:
@@ -78,6 +152,12 @@ public:
       Level level, std::shared_ptr<CacheSystem> cachesys, const Config &configs);
 
   void tick();
+  // Whether tick() would retry sending requests to lower levels
+  bool has_retries();
+  // Whether no miss of this level is outstanding
+  bool is_drained();
+  // Cache contents and predictor/prefetcher tables, the cache must be drained
+  void checkpoint(Checkpoint& ckpt);
   void gatherFromHigherLevels();
 
   void turnSectoredDRAMOff();
@@ -103,6 +183,11 @@ public:
 
 
   bool send(Request req);
+  // Functional counterpart of send(): looks the block up and fills it and
+  // the missing sectors from the lower levels at once, with evictions and
+  // predictor/prefetcher training, but no MSHRs, latencies or callbacks.
+  // Write-backs to the memory are dropped.
+  void warm(Request req);
 
   void concatlower(Cache* lower);
 
@@ -133,20 +218,24 @@ protected:
   unsigned int tag_offset;
   unsigned int mshr_entry_num;
 
-  typedef struct
-  {
-    long tag;
-    ulong sector_bits;
-    bool dirty;
-    ulong will_be_used_sectors;
-    ulong will_be_dirty_sectors;
-  } mshr_entry_type;
+  typedef MSHRFile::Entry mshr_entry_type;
 
-  std::vector<mshr_entry_type> mshr_entries;
+  MSHRFile mshr_entries;
   std::list<Request> retry_list;
 
   std::vector<CacheSet> cache_sets;
 
+  // Set in the config file with cache_replacement, for all cache levels
+  std::map<std::string, CacheSet::PolicyType> name_to_policy = {
+    {"MRU", CacheSet::PolicyType::MRU},
+    {"LRU", CacheSet::PolicyType::LRU},
+    {"SRRIP", CacheSet::PolicyType::SRRIP},
+    {"DRRIP", CacheSet::PolicyType::DRRIP},
+    {"Sector", CacheSet::PolicyType::Sector},
+  };
+  static const int DUELING_SETS = 32;
+  std::shared_ptr<CacheSet::DuelingMonitor> dueling;
+
   int calc_log2(int val) {
       int n = 0;
       while ((val >>= 1))
@@ -162,6 +251,15 @@ protected:
     return (addr >> tag_offset);
   }
 
+  // The sectors a request asks for from this level
+  ulong get_level_sector_bits(const Request& req) {
+    if (partialActivationDRAM)
+      return (1 << (64/sector_size)) - 1;
+    if (sectoredDRAM || DGMS)
+      return is_first_level ? req.sector_bits[0] : is_second_level ? req.sector_bits[1] : req.sector_bits[2];
+    return 0UL;
+  }
+
   // Align the address to cache line size
   long align(long addr) {
     return (addr & ~(block_size-1l));
@@ -192,6 +290,52 @@ protected:
 
 };
 
+// Requests bucketed by the cycle they are due at (a timing wheel). A request
+// must be due within WHEEL_SIZE cycles, requests due at the same cycle keep
+// their insertion order.
+class TimingWheel {
+public:
+  static const int WHEEL_SIZE = 64; // larger than any cache latency
+
+  TimingWheel() : buckets(WHEEL_SIZE) {}
+
+  void push(long now, long due, Request req) {
+    assert(due > now && due - now < WHEEL_SIZE && "A cache latency exceeds the timing wheel");
+    int bucket = due & (WHEEL_SIZE - 1);
+    buckets[bucket].push_back(std::move(req));
+    occupied |= 1UL << bucket;
+    count++;
+  }
+
+  // Moves the requests due at cycle to the end of reqs
+  void pop(long cycle, std::vector<Request>& reqs) {
+    int bucket = cycle & (WHEEL_SIZE - 1);
+    if (!(occupied & (1UL << bucket)))
+      return;
+    for (auto& req : buckets[bucket])
+      reqs.push_back(std::move(req));
+    count -= buckets[bucket].size();
+    buckets[bucket].clear();
+    occupied &= ~(1UL << bucket);
+  }
+
+  // The first cycle after now at which a request is due, -1 if there is none
+  long next_due(long now) const {
+    if (!occupied)
+      return -1;
+    int first = (now + 1) & (WHEEL_SIZE - 1);
+    uint64_t rotated = first ? (occupied >> first) | (occupied << (WHEEL_SIZE - first)) : occupied;
+    return now + 1 + __builtin_ctzll(rotated);
+  }
+
+  bool empty() const {return count == 0;}
+
+private:
+  std::vector<std::vector<Request>> buckets;
+  uint64_t occupied = 0; // a bit per non-empty bucket
+  size_t count = 0;
+};
+
 class CacheSystem {
 public:
   CacheSystem(const Config& configs, std::function<bool(Request)> send_memory):
@@ -216,17 +360,38 @@ public:
   // wait_list contains miss requests with their latencies in
   // cache. When this latency is met, the send_memory function
   // will be called to send the request to the memory system.
-  std::list<std::pair<long, Request> > wait_list;
+  TimingWheel wait_list;
+  // Due miss requests that the memory system has not accepted yet, in order
+  std::vector<Request> memory_queue;
 
   // hit_list contains hit requests with their latencies in cache.
   // callback function will be called when this latency is met and
   // set the instruction status to ready in processor's window.
-  std::list<std::pair<long, Request> > hit_list;
+  TimingWheel hit_list;
+  std::vector<Request> due_hits;
 
   std::function<bool(Request)> send_memory;
 
   long clk = 0;
+  // Functional warmup: the caches serve every request at once (see Cache::warm)
+  bool functional = false;
+
+  void send_after(int latency, Request req) {
+    wait_list.push(clk, clk + latency, std::move(req));
+  }
+
+  void callback_after(int latency, Request req) {
+    hit_list.push(clk, clk + latency, std::move(req));
+  }
+
+  bool is_empty() const {
+    return wait_list.empty() && memory_queue.empty() && hit_list.empty();
+  }
+
   void tick();
+  // The earliest clk at which a wait_list or hit_list entry gets due
+  // (memory_queue entries wait for the memory system to accept them)
+  long next_event();
 
   Cache::Level first_level;
   Cache::Level last_level;
@@ -3,20 +3,34 @@
 #include <stdio.h>
 
 #include "CacheSet.h"
+#include "Checkpoint.h"
 
-CacheSet::CacheSet(const int nWays, const PolicyType replacementPolicy) :
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+CacheSet::CacheSet(const int nWays, const PolicyType replacementPolicy,
+    std::shared_ptr<DuelingMonitor> monitor, const DuelingRole role) :
     replacementPolicy(replacementPolicy),
     nWays(nWays),
     sectorValids(nWays, 0UL), // all sectors are invalid
     instAddresses(nWays, 0UL),
+    owners(nWays, 0),
     usedSectors(nWays, 0UL), // all sectors are unused
     dirtySectors(nWays, 0UL),
     tags(nWays, 0UL), // all tags are "0"
     validVec(0UL), // nothing is valid
     busyVec(0UL), // nothing is busy
     dirtyVec(0UL), // nothing is dirty
-    mruVec(0UL) // nothing is most recently used
-    {}
+    mruVec(0UL), // nothing is most recently used
+    lastAccess(nWays, 0UL),
+    rrpv(nWays, RRPV_MAX),
+    monitor(monitor),
+    role(role)
+    {
+        assert(nWays <= 64 && "Ways are tracked in 64-bit vectors");
+        assert(replacementPolicy != PolicyType::DRRIP || monitor);
+    }
 
 bool CacheSet::isValid(const long tag)
 {
@@ -44,7 +58,30 @@ bool CacheSet::isDirty(const long tag)
 
 long CacheSet::findVictim()
 {
-    if (replacementPolicy == PolicyType::MRU)
+    if (replacementPolicy != PolicyType::MRU)
+    {
+        ulong ways = nWays == 64 ? ~0UL : (1UL << nWays) - 1;
+        ulong candidates = ways & ~busyVec;
+        // all ways are busy, the cache cannot evict any of them
+        if (!candidates)
+            return tags[0];
+
+        // fill an invalid way first
+        if (candidates & ~validVec)
+            return tags[__builtin_ctzl(candidates & ~validVec)];
+
+        if (replacementPolicy == PolicyType::SRRIP || replacementPolicy == PolicyType::DRRIP)
+            return tags[findRRIPVictim(candidates)];
+        if (replacementPolicy == PolicyType::Sector)
+            return tags[findSectorVictim(candidates)];
+
+        int victim = __builtin_ctzl(candidates);
+        for (int i = victim + 1 ; i < nWays ; i++)
+            if (bvMatchIdx(candidates, i) && lastAccess[i] < lastAccess[victim])
+                victim = i;
+        return tags[victim];
+    }
+    else if (replacementPolicy == PolicyType::MRU)
     {
         ulong plruBits = (~mruVec) & ((1UL << nWays) - 1);
 
@@ -96,11 +133,13 @@ bool CacheSet::evict(const long tag)
     sectorValids[i] = 0UL;
     usedSectors[i] = 0UL;
     instAddresses[i] = 0LL;
+    owners[i] = 0;
     dirtySectors[i] = 0UL;
 
     bool isDirty = bvMatchIdx(dirtyVec, i);
     bvUnsetIdx(dirtyVec, i);
     bvUnsetIdx(mruVec, i);
+    rrpv[i] = RRPV_MAX;
 
     assert(bvMatchIdx(busyVec, i) == 0 && "Evicting a busy cache block");
 
@@ -142,17 +181,31 @@ void CacheSet::access(const long tag, const ulong sectorBits, const bool isWrite
             bvSetIdx(mruVec, i);
         }
     }
+    else
+        touch(i, false);
 }
 
-void CacheSet::insert(const long oldTag, const long newTag, const long instAddr, const ulong sectorBits)
+void CacheSet::rereference(const long tag)
+{
+    if (replacementPolicy != PolicyType::SRRIP && replacementPolicy != PolicyType::DRRIP)
+        return;
+
+    int i = findWayIdx(tag);
+    assert(i >= 0 && "Re-referencing an invalid cache block");
+    rrpv[i] = 0; // hit priority
+}
+
+void CacheSet::insert(const long oldTag, const long newTag, const long instAddr, const int owner, const ulong sectorBits)
 {
     int i = findWayIdx(oldTag);
     tags[i] = newTag;
+    lastTag = -1;
 
     sectorValids[i] = sectorBits;
     usedSectors[i] = 0UL;
     dirtySectors[i] = 0UL;
     instAddresses[i] = instAddr;
+    owners[i] = owner;
 
     // Also update replacement state
 
@@ -166,6 +219,8 @@ void CacheSet::insert(const long oldTag, const long newTag, const long instAddr,
         bvSetIdx(mruVec, i);
     }
 
+    if (replacementPolicy != PolicyType::MRU)
+        touch(i, true);
 }
 
 void CacheSet::validate(const long tag)
@@ -259,18 +314,126 @@ long CacheSet::getInstAddr(const long tag)
     return instAddresses[i];
 }
 
+int CacheSet::getOwner(const long tag)
+{
+    int i = findWayIdx(tag);
+    if (i == -1)
+        return 0;
+    return owners[i];
+}
+
 
 // Helper functions
 
 int CacheSet::findWayIdx(const long tag)
 {
-    for (int i = 0 ; i < nWays ; i++)
+    // consecutive lookups are mostly for the same block
+    if (tag == lastTag)
+        return lastWay;
+
+    lastWay = scanWays(tag);
+    lastTag = tag;
+    return lastWay;
+}
+
+// the first way that holds tag, -1 if there is none. Compares four ways at
+// a time when built with AVX2 (see ARCH_FLAGS in the Makefile)
+int CacheSet::scanWays(const long tag)
+{
+    int i = 0;
+#ifdef __AVX2__
+    const __m256i key = _mm256_set1_epi64x(tag);
+    for ( ; i + 4 <= nWays ; i += 4)
+    {
+        __m256i ways = _mm256_loadu_si256((const __m256i*) &tags[i]);
+        int match = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(ways, key)));
+        if (match)
+            return i + __builtin_ctz(match);
+    }
+#endif
+    for ( ; i < nWays ; i++)
         if (tags[i] == tag)
             return i;
 
     return -1;
 }
 
+void CacheSet::touch(const int idx, const bool isInsert)
+{
+    lastAccess[idx] = ++accessCount;
+
+    if (replacementPolicy != PolicyType::SRRIP && replacementPolicy != PolicyType::DRRIP)
+        return;
+
+    if (!isInsert)
+        return;
+
+    bool bimodal = false;
+    if (replacementPolicy == PolicyType::DRRIP)
+    {
+        // an insertion is a miss, the leader sets train the policy selector
+        if (role == DuelingRole::SRRIPLeader)
+        {
+            if (monitor->psel < PSEL_MAX)
+                monitor->psel++;
+        }
+        else if (role == DuelingRole::BRRIPLeader)
+        {
+            if (monitor->psel > -PSEL_MAX)
+                monitor->psel--;
+        }
+
+        bimodal = role == DuelingRole::BRRIPLeader ||
+            (role == DuelingRole::Follower && monitor->psel > 0);
+    }
+
+    // BRRIP inserts with a long re-reference interval, except for one in BRRIP_EPSILON insertions
+    if (bimodal && (monitor->brripInsertions++ % BRRIP_EPSILON) != 0)
+        rrpv[idx] = RRPV_MAX;
+    else
+        rrpv[idx] = RRPV_MAX - 1;
+}
+
+int CacheSet::findRRIPVictim(const ulong candidates)
+{
+    while (true)
+    {
+        for (int i = 0 ; i < nWays ; i++)
+            if (bvMatchIdx(candidates, i) && rrpv[i] == RRPV_MAX)
+                return i;
+
+        for (int i = 0 ; i < nWays ; i++)
+            if (bvMatchIdx(candidates, i))
+                rrpv[i]++;
+    }
+}
+
+int CacheSet::findSectorVictim(const ulong candidates)
+{
+    int count = __builtin_popcountl(candidates);
+    int victim = -1;
+    for (int i = 0 ; i < nWays ; i++)
+    {
+        if (!bvMatchIdx(candidates, i))
+            continue;
+
+        // only the older half of the ways are victim candidates
+        int newer = 0;
+        for (int j = 0 ; j < nWays ; j++)
+            if (bvMatchIdx(candidates, j) && lastAccess[j] > lastAccess[i])
+                newer++;
+        if (newer < count / 2)
+            continue;
+
+        int used = __builtin_popcountl(usedSectors[i]);
+        int victimUsed = victim == -1 ? 0 : __builtin_popcountl(usedSectors[victim]);
+        if (victim == -1 || used < victimUsed ||
+            (used == victimUsed && lastAccess[i] < lastAccess[victim]))
+            victim = i;
+    }
+    return victim;
+}
+
 bool CacheSet::bvMatchIdx(const ulong bv, const int idx)
 {
     return bv & (1UL << idx);
@@ -309,4 +472,23 @@ ulong CacheSet::getDirtyVec()
 std::vector<ulong> CacheSet::getTags()
 {
     return tags;
-}
\ No newline at end of file
+}
+
+void CacheSet::checkpoint(ramulator::Checkpoint& ckpt)
+{
+    ckpt.check(nWays, "cache associativity");
+    ckpt.io(validVec);
+    ckpt.io(busyVec);
+    ckpt.io(dirtyVec);
+    ckpt.io(mruVec);
+    ckpt.io(lastAccess);
+    ckpt.io(accessCount);
+    ckpt.io(rrpv);
+    ckpt.io(sectorValids);
+    ckpt.io(usedSectors);
+    ckpt.io(dirtySectors);
+    ckpt.io(instAddresses);
+    ckpt.io(owners);
+    ckpt.io(tags);
+    lastTag = -1;
+}
@@ -1,20 +1,42 @@
 #ifndef CACHE_SET_HPP
 #define CACHE_SET_HPP
 
+#include <memory>
 #include <vector>
 // to include typedef ulong? UGLY
 #include "Request.h"
 
+namespace ramulator { class Checkpoint; }
+
 class CacheSet
 {
 public:
 
     enum class PolicyType
     {
-        MRU
+        MRU,
+        LRU,
+        SRRIP,
+        DRRIP,
+        Sector // among the older half of the ways (LRU), evict the one with the fewest used sectors
+    };
+
+    // DRRIP set dueling between SRRIP and BRRIP insertion, shared by the sets of a cache
+    struct DuelingMonitor
+    {
+        int psel = 0; // positive when the SRRIP leader sets miss more
+        ulong brripInsertions = 0;
+    };
+
+    enum class DuelingRole
+    {
+        Follower,
+        SRRIPLeader,
+        BRRIPLeader
     };
 
-    CacheSet(const int nWays, const PolicyType replacementPolicy);
+    CacheSet(const int nWays, const PolicyType replacementPolicy,
+        std::shared_ptr<DuelingMonitor> monitor = nullptr, const DuelingRole role = DuelingRole::Follower);
 
     bool isValid(const long tag);
     bool isBusy(const long tag);
@@ -37,9 +59,12 @@ public:
     // fetching useful data from the cache array
     // E.g., hit in cache, sector miss in cache
     void access(const long tag, const ulong sectorBits, const bool isWrite);
+    // A demand request found the block in the cache (RRIP hit promotion,
+    // fills also go through access())
+    void rereference(const long tag);
 
     // To manipulate valid state
-    void insert(const long oldTag, const long newTag, const long instAddr, const ulong sectorBits = 0);
+    void insert(const long oldTag, const long newTag, const long instAddr, const int owner, const ulong sectorBits = 0);
     void validate(const long tag);
     void invalidate(const long tag);
 
@@ -60,12 +85,15 @@ public:
     ulong getUsedSectors(const long tag); 
     ulong getDirtySectors(const long tag); 
     long getInstAddr(const long tag);
+    int getOwner(const long tag);
 
     ulong getValidVec();
     ulong getBusyVec();
     ulong getDirtyVec();
     std::vector<ulong> getTags();
 
+    void checkpoint(ramulator::Checkpoint& ckpt);
+
 private:
 
     PolicyType replacementPolicy;
@@ -79,12 +107,30 @@ private:
     // One-hot encoded metadata bits for MRU replacement policy
     ulong mruVec;
 
+    // LRU and Sector replacement policies: the last access of each way
+    std::vector<ulong> lastAccess;
+    ulong accessCount = 0;
+
+    // SRRIP and DRRIP replacement policies: re-reference prediction values
+    static const int RRPV_MAX = 3;
+    static const int PSEL_MAX = 511;
+    static const int BRRIP_EPSILON = 32;
+    std::vector<unsigned char> rrpv;
+    std::shared_ptr<DuelingMonitor> monitor;
+    DuelingRole role;
+
+    // The way of the last looked up tag, reset when a tag changes
+    long lastTag = -1;
+    int lastWay = -1;
+
     // Sector Cache extensions
     // One-hot encoded values for every cache line (one in each way)  
     std::vector<ulong> sectorValids;
     std::vector<ulong> usedSectors;
     std::vector<ulong> dirtySectors;
     std::vector<long> instAddresses;
+    // the core whose request inserted the line
+    std::vector<int> owners;
     // End Sector Cache extensions
 
     // Other cache metadata
@@ -95,6 +141,12 @@ private:
      * @return the index of the tag if it exists, -1 otherwise
      */
     int findWayIdx(const long tag);
+    int scanWays(const long tag);
+
+    // Replacement state updates when a block is inserted or accessed
+    void touch(const int idx, const bool isInsert);
+    int findRRIPVictim(const ulong candidates);
+    int findSectorVictim(const ulong candidates);
 
     /**
      * Find if an index is set in the bitvector
@@ -0,0 +1,181 @@
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ramulator
+{
+
+/*
+  Binary checkpoint of the simulator state after warmup (see run_cputrace).
+  The same io() calls save or restore a value depending on the mode, so every
+  component describes its state once in a checkpoint(Checkpoint&) function.
+  check() records configuration-dependent values (e.g., the number of cache
+  sets) and aborts the restore if they do not match the current configuration.
+*/
+class Checkpoint
+{
+public:
+    enum class Mode {Save, Restore};
+
+    Checkpoint(const std::string& fname, Mode mode) : fname(fname), mode(mode)
+    {
+        file = fopen(fname.c_str(), saving() ? "wb" : "rb");
+        if (!file)
+            fail("cannot open the checkpoint file");
+
+        const char MAGIC[8] = {'R', 'A', 'M', 'C', 'K', 'P', 'T', '\0'};
+        char magic[sizeof(MAGIC)];
+        memcpy(magic, MAGIC, sizeof(MAGIC));
+        io(magic);
+        if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+            fail("not a checkpoint file");
+        check(VERSION, "checkpoint version");
+    }
+
+    ~Checkpoint()
+    {
+        if (saving() && (ferror(file) || fclose(file) != 0))
+            fail("cannot write the checkpoint file");
+        else if (!saving())
+            fclose(file);
+    }
+
+    bool saving() const {return mode == Mode::Save;}
+
+    template<typename T>
+    void io(T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "use an io() overload for this type");
+        io(&value, 1);
+    }
+
+    template<typename T>
+    void io(T* values, size_t count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "use an io() overload for this type");
+        if (saving())
+            fwrite(values, sizeof(T), count, file);
+        else if (fread(values, sizeof(T), count, file) != count)
+            fail("unexpected end of the checkpoint");
+    }
+
+    template<typename A, typename B>
+    void io(std::pair<A, B>& value)
+    {
+        io(value.first);
+        io(value.second);
+    }
+
+    template<typename T>
+    void io(std::vector<T>& values)
+    {
+        io_size(values);
+        io_elements(values, std::is_trivially_copyable<T>());
+    }
+
+    template<typename T>
+    void io(std::deque<T>& values)
+    {
+        io_size(values);
+        for (auto& value : values)
+            io(value);
+    }
+
+    template<typename K, typename V>
+    void io(std::map<K, V>& values)
+    {
+        io_map(values);
+    }
+
+    template<typename K, typename V>
+    void io(std::unordered_map<K, V>& values)
+    {
+        io_map(values);
+    }
+
+    // the restored value must be the one of the current configuration
+    void check(long value, const char* what)
+    {
+        long saved = value;
+        io(saved);
+        if (saved != value) {
+            fprintf(stderr, "Checkpoint %s: %s is %ld, but %ld in the current configuration\n",
+                fname.c_str(), what, saved, value);
+            exit(1);
+        }
+    }
+
+private:
+    static const long VERSION = 3;
+
+    std::string fname;
+    Mode mode;
+    FILE* file;
+
+    void fail(const char* msg)
+    {
+        fprintf(stderr, "Checkpoint %s: %s\n", fname.c_str(), msg);
+        exit(1);
+    }
+
+    template<typename C>
+    void io_size(C& values)
+    {
+        long size = values.size();
+        io(size);
+        if (!saving()) {
+            values.clear();
+            values.resize(size);
+        }
+    }
+
+    template<typename T>
+    void io_elements(std::vector<T>& values, std::true_type)
+    {
+        io(values.data(), values.size());
+    }
+
+    template<typename T>
+    void io_elements(std::vector<T>& values, std::false_type)
+    {
+        for (auto& value : values)
+            io(value);
+    }
+
+    template<typename M>
+    void io_map(M& values)
+    {
+        long size = values.size();
+        io(size);
+        if (saving()) {
+            for (auto& entry : values) {
+                auto key = entry.first;
+                io(key);
+                io(entry.second);
+            }
+            return;
+        }
+        values.clear();
+        for (long i = 0; i < size; i++) {
+            typename M::key_type key;
+            typename M::mapped_type value;
+            io(key);
+            io(value);
+            values.emplace(key, value);
+        }
+    }
+};
+
+} /* namespace ramulator */
+
+#endif /* __CHECKPOINT_H */
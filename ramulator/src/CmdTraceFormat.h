@@ -0,0 +1,64 @@
+#ifndef __CMD_TRACE_FORMAT_H
+#define __CMD_TRACE_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace ramulator
+{
+
+/*
+  Binary DRAM command trace of a rank (record_cmd_trace with
+  cmd_trace_format = binary, see CmdTraceWriter). A header with the command
+  names of the DRAM standard is followed by fixed-width records, one per
+  command, with the cycles since the previous record. tools/cmdtrace2text
+  converts it to the text command trace read by DRAMPower.
+  Records are stored in the byte order of the machine that wrote them.
+  DRAMPower reads the trace with its own copy of these structs
+  (BinaryTrace in DRAMPower/src/TraceParser.h), keep the two in sync.
+*/
+namespace BinaryCmdTrace
+{
+    const char MAGIC[8] = {'R', 'A', 'M', 'C', 'M', 'D', 'B', 'N'};
+    const uint32_t VERSION = 1;
+    const uint8_t NO_COMMAND = 0xff; // a record that only advances the time
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+        uint32_t commands; // followed by this many CommandNames
+        uint32_t reserved;
+    };
+
+    struct CommandName
+    {
+        char name[16];
+    };
+
+    struct Record
+    {
+        uint32_t delta; // cycles since the previous record
+        uint8_t command; // index into the command names
+        uint8_t sectors; // activated sectors of a PRA
+        uint16_t bank;
+    };
+
+    static_assert(sizeof(Header) == 24, "unexpected binary command trace header layout");
+    static_assert(sizeof(CommandName) == 16, "unexpected binary command trace name layout");
+    static_assert(sizeof(Record) == 8, "unexpected binary command trace record layout");
+
+    inline bool is_binary(const Header& header)
+    {
+        return memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+    // the fields that follow the command name in a text command trace line
+    inline bool has_bank(const char* name) {return strcmp(name, "PREA") != 0 && strcmp(name, "REF") != 0;}
+    inline bool has_sectors(const char* name) {return strcmp(name, "PRA") == 0;}
+} /* namespace BinaryCmdTrace */
+
+} /* namespace ramulator */
+
+#endif /* __CMD_TRACE_FORMAT_H */
@@ -0,0 +1,88 @@
+#include "CmdTraceWriter.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace ramulator;
+
+CmdTraceWriter::CmdTraceWriter(const string& fname, const vector<string>& command_names)
+    : fname(fname)
+{
+    file = fopen(fname.c_str(), "wb");
+    if (!file) {
+        cerr << "Cannot create the command trace " << fname << endl;
+        exit(1);
+    }
+
+    assert(command_names.size() < BinaryCmdTrace::NO_COMMAND);
+    BinaryCmdTrace::Header header;
+    memcpy(header.magic, BinaryCmdTrace::MAGIC, sizeof(header.magic));
+    header.version = BinaryCmdTrace::VERSION;
+    header.record_size = sizeof(BinaryCmdTrace::Record);
+    header.commands = command_names.size();
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, file);
+    for (auto& name : command_names) {
+        BinaryCmdTrace::CommandName entry = {};
+        strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+        fwrite(&entry, sizeof(entry), 1, file);
+    }
+
+    block.reserve(BLOCK_RECORDS);
+    thread = std::thread(&CmdTraceWriter::run, this);
+}
+
+CmdTraceWriter::~CmdTraceWriter()
+{
+    if (!block.empty())
+        submit();
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond.notify_all();
+    thread.join();
+
+    if (fclose(file) != 0 || failed)
+        cerr << "Cannot write the command trace " << fname << endl;
+}
+
+void CmdTraceWriter::submit()
+{
+    unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this] {return full_blocks.size() < MAX_PENDING;});
+    full_blocks.push_back(std::move(block));
+    if (free_blocks.empty()) {
+        block = vector<BinaryCmdTrace::Record>();
+        block.reserve(BLOCK_RECORDS);
+    } else {
+        block = std::move(free_blocks.back());
+        free_blocks.pop_back();
+    }
+    lock.unlock();
+    cond.notify_all();
+}
+
+void CmdTraceWriter::run()
+{
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cond.wait(lock, [this] {return stop || !full_blocks.empty();});
+        if (full_blocks.empty())
+            return; // stopped and nothing left to write
+
+        auto records = std::move(full_blocks.front());
+        full_blocks.pop_front();
+        lock.unlock();
+
+        if (fwrite(records.data(), sizeof(BinaryCmdTrace::Record), records.size(), file) != records.size())
+            failed = true;
+        records.clear();
+
+        lock.lock();
+        free_blocks.push_back(std::move(records));
+        cond.notify_all();
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef __CMD_TRACE_WRITER_H
+#define __CMD_TRACE_WRITER_H
+
+#include "CmdTraceFormat.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ramulator
+{
+
+/*
+  Writes a binary DRAM command trace (see CmdTraceFormat.h). Records are
+  collected in blocks that a background thread writes to the file, so the
+  controller only appends to memory. At most MAX_PENDING full blocks wait
+  for the thread, after that write() waits for it.
+*/
+class CmdTraceWriter
+{
+public:
+    CmdTraceWriter(const std::string& fname, const std::vector<std::string>& command_names);
+    ~CmdTraceWriter();
+
+    void write(long clk, int command, int bank, unsigned long sectors)
+    {
+        long delta = clk - last_clk;
+        for (; delta > UINT32_MAX; delta -= UINT32_MAX)
+            push({UINT32_MAX, BinaryCmdTrace::NO_COMMAND, 0, 0});
+        push({uint32_t(delta), uint8_t(command), uint8_t(sectors), uint16_t(bank)});
+        last_clk = clk;
+    }
+
+private:
+    static const size_t BLOCK_RECORDS = 1 << 16;
+    static const size_t MAX_PENDING = 16;
+
+    void push(const BinaryCmdTrace::Record& rec)
+    {
+        block.push_back(rec);
+        if (block.size() == BLOCK_RECORDS)
+            submit();
+    }
+    // hands the block to the thread and continues with an empty one
+    void submit();
+    void run();
+
+    std::string fname;
+    FILE* file;
+    long last_clk = 0;
+    std::vector<BinaryCmdTrace::Record> block;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::vector<BinaryCmdTrace::Record>> full_blocks, free_blocks;
+    bool stop = false;
+    bool failed = false;
+    std::thread thread;
+};
+
+} /* namespace ramulator */
+
+#endif /* __CMD_TRACE_WRITER_H */
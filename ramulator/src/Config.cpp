@@ -68,6 +68,18 @@ void Config::parse(const string& fname)
           pattern_table_ways = atoi(tokens[1].c_str());
         } else if (tokens[0] == "utilization_window") {
           utilization_window = atoi(tokens[1].c_str());
+        } else if (tokens[0] == "channel_threads") {
+          channel_threads = atoi(tokens[1].c_str());
+        } else if (tokens[0] == "window_ipc") {
+          window_ipc = atoi(tokens[1].c_str());
+        } else if (tokens[0] == "window_depth") {
+          window_depth = atoi(tokens[1].c_str());
+        } else if (tokens[0] == "power_epoch") {
+          power_epoch = atoi(tokens[1].c_str());
+        } else if (tokens[0] == "stats_epoch") {
+          stats_epoch = atoi(tokens[1].c_str());
+        } else if (tokens[0] == "scheduler_cap") {
+          scheduler_cap = atoi(tokens[1].c_str());
         } else if (tokens[0] == "dpower_config_path") {
           dpower_config_path = tokens[1];
         } else if (tokens[0] == "stride_pref_mode") {
@@ -28,6 +28,12 @@ private:
     int pattern_table_size = 8;
     int pattern_table_ways = 8;
     int utilization_window = 64;
+    int channel_threads = 0; // 0 or 1 ticks all channels on the simulation thread
+    int window_ipc = 4;
+    int window_depth = 128;
+    int power_epoch = 100000; // memory cycles per row of the power trace
+    int stats_epoch = 0; // cycles between stats snapshots, 0 is no snapshots
+    int scheduler_cap = 16; // row hits before FRFCFS_Cap stops prioritizing a row
 
     int stride_pref_mode = 0;
     int stride_pref_entries = 0;
@@ -82,6 +88,12 @@ public:
     int get_pattern_table_size() const {return pattern_table_size;}
     int get_pattern_table_ways() const {return pattern_table_ways;}
     int get_utilization_window_size() const {return utilization_window;}
+    int get_channel_threads() const {return channel_threads;}
+    int get_window_ipc() const {return window_ipc;}
+    int get_window_depth() const {return window_depth;}
+    int get_power_epoch() const {return power_epoch;}
+    int get_stats_epoch() const {return stats_epoch;}
+    int get_scheduler_cap() const {return scheduler_cap;}
     std::string get_dpower_config_path() const {return dpower_config_path;}
 
 
@@ -262,6 +274,39 @@ public:
       }
       return false;
     }
+
+    bool is_clock_skipping() const {
+      // the default value is false
+      if (options.find("clock_skipping") != options.end()) {
+        if ((options.find("clock_skipping"))->second == "on") {
+          return true;
+        }
+        return false;
+      }
+      return false;
+    }
+
+    bool is_functional_warmup() const {
+      // the default value is false
+      if (options.find("functional_warmup") != options.end()) {
+        if ((options.find("functional_warmup"))->second == "on") {
+          return true;
+        }
+        return false;
+      }
+      return false;
+    }
+
+    bool is_stats_epoch_delta() const {
+      // the default value is false
+      if (options.find("stats_epoch_delta") != options.end()) {
+        if ((options.find("stats_epoch_delta"))->second == "on") {
+          return true;
+        }
+        return false;
+      }
+      return false;
+    }
 };
 
 
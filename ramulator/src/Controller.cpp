@@ -9,7 +9,7 @@ using namespace ramulator;
 namespace ramulator
 {
 
-static vector<int> get_offending_subarray(DRAM<SALP>* channel, vector<int> & addr_vec){
+static AddrVec get_offending_subarray(DRAM<SALP>* channel, AddrVec & addr_vec){
     int sa_id = 0;
     auto rank = channel->children[addr_vec[int(SALP::Level::Rank)]];
     auto bank = rank->children[addr_vec[int(SALP::Level::Bank)]];
@@ -19,7 +19,7 @@ static vector<int> get_offending_subarray(DRAM<SALP>* channel, vector<int> & add
             sa_id = sa_other->id;
             break;
         }
-    vector<int> offending = addr_vec;
+    AddrVec offending = addr_vec;
     offending[int(SALP::Level::SubArray)] = sa_id;
     offending[int(SALP::Level::Row)] = -1;
     return offending;
@@ -27,7 +27,7 @@ static vector<int> get_offending_subarray(DRAM<SALP>* channel, vector<int> & add
 
 
 template <>
-vector<int> Controller<SALP>::get_addr_vec(SALP::Command cmd, list<Request>::iterator req){
+AddrVec Controller<SALP>::get_addr_vec(SALP::Command cmd, list<Request>::iterator req){
     if (cmd == SALP::Command::PRE_OTHER)
         return get_offending_subarray(channel, req->addr_vec);
     else
@@ -40,7 +40,7 @@ bool Controller<SALP>::is_ready(list<Request>::iterator req){
     SALP::Command cmd = get_first_cmd(req);
     if (cmd == SALP::Command::PRE_OTHER){
 
-        vector<int> addr_vec = get_offending_subarray(channel, req->addr_vec);
+        AddrVec addr_vec = get_offending_subarray(channel, req->addr_vec);
         return channel->check(cmd, addr_vec.data(), clk);
     }
     else return channel->check(cmd, req->addr_vec.data(), clk);
@@ -58,6 +58,7 @@ void Controller<TLDRAM>::tick(){
     req_queue_length_sum += readq.size() + writeq.size();
     read_req_queue_length_sum += readq.size();
     write_req_queue_length_sum += writeq.size();
+    scheduler->tick();
 
     /*** 1. Serve completed reads ***/
     if (pending.size()) {
@@ -93,11 +94,11 @@ void Controller<TLDRAM>::tick(){
     if (otherq.size())
         queue = &otherq;  // "other" requests are rare, so we give them precedence over reads/writes
 
-    auto req = scheduler->get_head(queue->q);
+    auto req = scheduler->get_head(*queue);
     if (req == queue->q.end() || !is_ready(req)) {
         // we couldn't find a command to schedule -- let's try to be speculative
         auto cmd = TLDRAM::Command::PRE;
-        vector<int> victim = rowpolicy->get_victim(cmd);
+        AddrVec victim = rowpolicy->get_victim(cmd);
         if (!victim.empty()){
             issue_cmd(cmd, victim, 0);
         }
@@ -124,6 +125,7 @@ void Controller<TLDRAM>::tick(){
                 ++row_misses;
             }
           read_transaction_bytes += tx;
+          epoch_read_bytes[req->addr_vec[int(TLDRAM::Level::Rank)]] += tx;
         } else if (req->type == Request::Type::WRITE) {
           if (is_row_hit(req)) {
               ++write_row_hits[coreid];
@@ -136,6 +138,7 @@ void Controller<TLDRAM>::tick(){
               ++row_misses;
           }
           write_transaction_bytes += tx;
+          epoch_write_bytes[req->addr_vec[int(TLDRAM::Level::Rank)]] += tx;
         }
     }
 
@@ -147,6 +150,7 @@ void Controller<TLDRAM>::tick(){
     // issue command on behalf of request
     auto cmd = get_first_cmd(req);
     issue_cmd(cmd, get_addr_vec(cmd, req), 0);
+    scheduler->issued(*req, cmd == channel->spec->translate[int(req->type)]);
 
     // check whether this is the last command (which finishes the request)
     if (cmd != channel->spec->translate[int(req->type)])
@@ -155,19 +159,19 @@ void Controller<TLDRAM>::tick(){
     // set a future completion time for read requests
     if (req->type == Request::Type::READ || req->type == Request::Type::EXTENSION) {
         req->depart = clk + channel->spec->read_latency;
-        pending.push_back(*req);
+        pending.push_back(std::move(*req));
     }
     if (req->type == Request::Type::WRITE) {
         channel->update_serving_requests(req->addr_vec.data(), -1, clk);
     }
 
     // remove request from queue
-    queue->q.erase(req);
+    queue->erase(req);
 }
 
 template<>
 void Controller<TLDRAM>::cmd_issue_autoprecharge(typename TLDRAM::Command& cmd,
-                                                    const vector<int>& addr_vec) {
+                                                    const AddrVec& addr_vec) {
     //TLDRAM currently does not have autoprecharge commands
     return;
 }
@@ -192,21 +196,31 @@ template <typename T>
 
         rolling_sum_queue_length += readq.size() + pending.size();
 
+        if (scheduler->tick())
+            last_state_change = clk;
+
         if (dynamic_policy)
         {
             if (clk % 1000 == 0)
             {
                 int avg_len = rolling_sum_queue_length/1000;
                 //printf("%d\n",avg_len);
+                last_state_change = clk;
                 if (avg_len > 30 && dynamicOn == false)
                 {
                     dynamicOn = true;
-                    proc->turnSectorDRAMOn();
+                    if (defer_callbacks)
+                        sector_dram_switch = 1;
+                    else
+                        proc->turnSectorDRAMOn();
                 }
                 else if (avg_len <= 30 && dynamicOn == true)
                 {
                     dynamicOn = false;
-                    proc->turnSectorDRAMOff();
+                    if (defer_callbacks)
+                        sector_dram_switch = -1;
+                    else
+                        proc->turnSectorDRAMOff();
                 }
                 rolling_sum_queue_length = 0;
             }
@@ -215,10 +229,11 @@ template <typename T>
         if(warmup_complete && !dpower_is_reset) {
             discard_DPowerWindow(); // discarding the last window results collected during warmup
             dpower_is_reset = true;
+            last_state_change = clk;
         }
 
-        const uint32_t DPOWER_UPDATE_PERIOD = 50000000;
-        if (clk % DPOWER_UPDATE_PERIOD == (DPOWER_UPDATE_PERIOD - 1)){
+        if (clk % dpower_period == (dpower_period - 1)){
+            last_state_change = clk;
             if (warmup_complete)
                 update_DPower();
             else
@@ -240,49 +255,50 @@ template <typename T>
                 if (sectoredDRAM && sector_size == 8)
                     assert(req.sector_bits[4] < 256);
 
-                req.callback(req);
+                if (defer_callbacks)
+                    completed.push_back(req);
+                else
+                    req.callback(req);
                 pending.pop_front();
+                last_state_change = clk;
 
                 /* Sectored DRAM (and SALP) */
                 if(sectoredDRAM && sectoredDRAMSALP){
                     auto parallelRead = parallelReads.find(req.addr);
                     if( parallelRead != parallelReads.end()){
-                        parallelRead->second.callback(parallelRead->second);
+                        if (defer_callbacks)
+                            completed.push_back(parallelRead->second);
+                        else
+                            parallelRead->second.callback(parallelRead->second);
                         parallelReads.erase(req.addr);
                     }
                 }
             }
         }
 
-        /** Sectored DRAM **/
-        // dequeue from FAW queue
-        if (faw_queue.size())
-        {
-            if (clk - faw_queue.front().tick > 34 /*TODO: hardcoded, nFAW = 34 cycles in DDR4-3200 for x8 chips*/)
-            {
-                tFAW_budget += faw_queue.front().sectors;
-                faw_queue.pop();
-            }
-        }
-
-        /** Sectored DRAM **/
-
         /*** 2. Refresh scheduler ***/
         refresh->tick_ref();
 
         if (!can_schedule)
             return;
 
+        last_sched_clk = clk;
+        last_sched_faw_stall = -1;
+
         /*** 3. Should we schedule writes? ***/
         if (!write_mode) {
             // yes -- write queue is almost full or read queue is empty
-            if (writeq.size() > int(wr_high_watermark * writeq.max) || readq.size() == 0)
+            if (writeq.size() > int(wr_high_watermark * writeq.max) || readq.size() == 0) {
                 write_mode = true;
+                last_state_change = clk;
+            }
         }
         else {
             // no -- write queue is almost empty and read queue is not empty
-            if (writeq.size() < int(wr_low_watermark * writeq.max) && readq.size() != 0)
+            if (writeq.size() < int(wr_low_watermark * writeq.max) && readq.size() != 0) {
                 write_mode = false;
+                last_state_change = clk;
+            }
         }
 
         /*** 4. Find the best command to schedule, if any ***/
@@ -291,13 +307,13 @@ template <typename T>
         // are requests available to service in this cycle
         Queue* queue = &actq;
         typename T::Command cmd;
-        auto req = scheduler->get_head(queue->q);
+        auto req = scheduler->get_head(*queue);
 
         bool is_valid_req = (req != queue->q.end());
 
         if(is_valid_req) {
             cmd = get_first_cmd(req);
-            is_valid_req = is_ready(cmd, req->addr_vec);
+            is_valid_req = is_ready(req);
         }
 
         if (!is_valid_req) {
@@ -306,29 +322,25 @@ template <typename T>
             if (otherq.size())
                 queue = &otherq;  // "other" requests are rare, so we give them precedence over reads/writes
 
-            req = scheduler->get_head(queue->q);
+            req = scheduler->get_head(*queue);
 
             is_valid_req = (req != queue->q.end());
 
             if(is_valid_req){
                 cmd = get_first_cmd(req);
-                is_valid_req = is_ready(cmd, req->addr_vec);
+                is_valid_req = is_ready(req);
 
                 // Fix the useless ACT bug: If the first RD/WR to an opened row is being delayed too much,
                 // the PRE command from other requests could become ready which creates a useless activate
                 // Solution: Make sure a row is kept open before at least 1 RD/WR is served.
                 if (is_valid_req && channel->spec->is_closing(cmd))
                 {
-                    auto begin = req->addr_vec.begin();
-                    auto end = begin + int(T::Level::Row);
-                    std::vector<int> rowgroup(begin, end);
-
-                    auto match = rowtable->table.find(rowgroup);
-                    if(match == rowtable->table.end())
+                    auto match = rowtable->find(req->addr_vec);
+                    if(match == nullptr)
                         is_valid_req = true;
                     else
                     {
-                        if (match->second.hits == 0)
+                        if (match->hits == 0)
                             is_valid_req = false;
                     }
 
@@ -339,7 +351,7 @@ template <typename T>
         if (!is_valid_req) {
             // we couldn't find a command to schedule -- let's try to be speculative
             auto cmd = T::Command::PRE;
-            vector<int> victim = rowpolicy->get_victim(cmd);
+            AddrVec victim = rowpolicy->get_victim(cmd);
             if (!victim.empty()){
                 issue_cmd(cmd, victim, 0UL);
             }
@@ -362,7 +374,8 @@ template <typename T>
                     if(req->type == Request::Type::READ) 
                         parallelReads.insert(std::pair<long int, Request>(req->addr,**parallel_req));
                     
-                    queue->q.erase(*parallel_req);
+                    queue->erase(*parallel_req);
+                    last_state_change = clk;
                     collapsed_sector_bits = collapsed_sector_bits | (*parallel_req)->sector_bits[4];
                 }
                 acts += count_activated_sectors(collapsed_sector_bits);
@@ -373,67 +386,41 @@ template <typename T>
 
             //Check tFAW
             if(cmd == T::Command::ACT) {
-                if((tFAW_budget - acts) <= 0)
+                int rank = req->addr_vec[int(T::Level::Rank)];
+                if(!faw_trackers[rank].fits(clk, acts))
                 {
                     // we do not have enough budget, controller will remember this
                     faw_penalty_cycles++;
+                    faw_penalty_cycles_rank[rank]++;
+                    last_sched_faw_stall = rank;
                     return;
                 }
                 // we can issue ACT (PRA)
                 // reduce faw budget
-                tFAW_budget -= acts;
-                faw_queue.push({clk, acts});
+                faw_trackers[rank].activate(clk, acts);
             }
         }
         /* End SectoredDRAM with parallelization */
 
         /* SectoredDRAM on its own without parallelization */
-        if (sectoredDRAM || partialActivationDRAM || fgDRAM || halfDRAM)
-        {
-            int acts = count_activated_sectors(req->sector_bits[4]);
-
-            if (partialActivationDRAM)
-                if (req->type == Request::Type::READ)
-                    acts = 64/sector_size;
-
-            if (fgDRAM)
-                acts = 1; // always opens one sector
-
-            if (halfDRAM)
-                acts = 64/sector_size/2; // always opens half a row
-
-            if (sectoredDRAM && burstChopDRAM)
-                acts = 64/sector_size;
-
-            //Check tFAW
-            if(cmd == T::Command::ACT) {
-                if((tFAW_budget - acts) < 0)
-                {
-                    // we do not have enough budget, controller will remember this
-                    faw_penalty_cycles++;
-                    return;
-                }
-                // we can issue ACT (PRA)
-                // reduce faw budget
-                tFAW_budget -= acts;
-                faw_queue.push({clk, acts});
-            }
-        }
-        else
-        {
-            int acts = 1;
-            if(cmd == T::Command::ACT) {
-                if((tFAW_budget - acts) < 0)
-                {
-                    // we do not have enough budget, controller will remember this
-                    faw_penalty_cycles++;
-                    return;
-                }
-                // we can issue ACT (PRA)
-                // reduce faw budget
-                tFAW_budget -= acts;
-                faw_queue.push({clk, acts});
+        if (cmd == T::Command::ACT && sectoredDRAM && scheduler->type == Scheduler<T>::Type::FRFCFS_Sector)
+            merge_row_sectors(req);
+
+        //Check tFAW
+        if(cmd == T::Command::ACT) {
+            int rank = req->addr_vec[int(T::Level::Rank)];
+            int acts = activated_sectors(req->type, req->sector_bits[4]);
+            if(!faw_trackers[rank].fits(clk, acts))
+            {
+                // we do not have enough budget, controller will remember this
+                faw_penalty_cycles++;
+                faw_penalty_cycles_rank[rank]++;
+                last_sched_faw_stall = rank;
+                return;
             }
+            // we can issue ACT (PRA)
+            // reduce faw budget
+            faw_trackers[rank].activate(clk, acts);
         }
         /* End SectoredDRAM */
 
@@ -483,6 +470,7 @@ template <typename T>
                     ++row_misses;
                 }
               read_transaction_bytes += tx;
+              epoch_read_bytes[req->addr_vec[int(T::Level::Rank)]] += tx;
             } else if (req->type == Request::Type::WRITE) {
 
             //printf("WRITE Transferring %d bytes, %f\n", tx, rolling_avg_tx);
@@ -504,6 +492,7 @@ template <typename T>
                   ++row_misses;
               }
               write_transaction_bytes += tx;
+              epoch_write_bytes[req->addr_vec[int(T::Level::Rank)]] += tx;
             }
         }
 
@@ -512,6 +501,7 @@ template <typename T>
             issue_cmd(cmd, get_addr_vec(cmd, req), req->sector_bits[4]);
         else
             issue_cmd(cmd, get_addr_vec(cmd, req), req->sector_bits[3]);
+        scheduler->issued(*req, cmd == channel->spec->translate[int(req->type)]);
 
         if (sectoredDRAM && sector_size == 8 && req->type != Request::Type::REFRESH)
             assert(req->sector_bits[4] < 256);
@@ -521,8 +511,8 @@ template <typename T>
         if (cmd != channel->spec->translate[int(req->type)]) {
             if(channel->spec->is_opening(cmd)) {
                 // promote the request that caused issuing activation to actq
-                actq.q.push_back(*req);
-                queue->q.erase(req);
+                actq.push_back(std::move(*req));
+                queue->erase(req);
             }
 
             return;
@@ -541,7 +531,7 @@ template <typename T>
             }
             if (fgDRAM)
                 req->depart = clk + channel->spec->read_latency * 64/sector_size;
-            pending.push_back(*req);
+            pending.push_back(std::move(*req));
         }
 
         if (req->type == Request::Type::WRITE) {
@@ -550,7 +540,21 @@ template <typename T>
         }
 
         // remove request from queue
-        queue->q.erase(req);
+        queue->erase(req);
+    }
+
+template <typename T>
+    void Controller<T>::run_deferred()
+    {
+        if (sector_dram_switch > 0)
+            proc->turnSectorDRAMOn();
+        else if (sector_dram_switch < 0)
+            proc->turnSectorDRAMOff();
+        sector_dram_switch = 0;
+
+        for (auto& req : completed)
+            req.callback(req);
+        completed.clear();
     }
 
     template class Controller<DDR4>;
@@ -6,13 +6,19 @@
 #include <deque>
 #include <fstream>
 #include <list>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
 #include <queue>
+#include <set>
+#include <unordered_map>
 
+#include "Checkpoint.h"
+#include "CmdTraceWriter.h"
 #include "Config.h"
 #include "DRAM.h"
+#include "FAWTracker.h"
 #include "Refresh.h"
 #include "Request.h"
 #include "Scheduler.h"
@@ -62,6 +68,7 @@ protected:
     ScalarStat write_req_queue_length_sum;
 
     ScalarStat faw_penalty_cycles;
+    VectorStat faw_penalty_cycles_rank;
 
 #ifndef INTEGRATED_WITH_GEM5
     VectorStat record_read_hits;
@@ -97,6 +104,93 @@ public:
         list<Request> q;
         unsigned int max = 32;
         unsigned int size() {return q.size();}
+
+        // the oldest request first, requests that arrived in the same cycle in queue order
+        struct Older {
+            bool operator()(list<Request>::iterator req1, list<Request>::iterator req2) const
+            {
+                if (req1->arrive != req2->arrive)
+                    return req1->arrive < req2->arrive;
+                return req1->queue_seq < req2->queue_seq;
+            }
+        };
+
+        // Indices over q, requests must be added and removed through push_back() and erase()
+        unordered_map<long, int> addrs; // line address -> number of requests
+        unordered_map<long, vector<list<Request>::iterator>> rows; // (rank, ..., bank, row) -> requests
+        unordered_map<long, set<list<Request>::iterator, Older>> rowgroups; // (rank, ..., bank) -> requests
+
+        list<Request> free_nodes; // nodes of erased requests, reused by push_back() instead of allocating
+        long next_seq = 0; // queue_seq of the next request, so that q is in queue_seq order
+
+        static long rowgroup_key(const AddrVec& addr_vec)
+        {
+            long key = 0;
+            for (int l = int(T::Level::Rank); l < int(T::Level::Row); l++)
+                key = (key << 8) | (addr_vec[l] & 0xff);
+            return key;
+        }
+
+        static long row_key(long rowgroup, int row)
+        {
+            return (rowgroup << 32) | (row & 0xffffffffL);
+        }
+
+        static long row_key(const AddrVec& addr_vec)
+        {
+            return row_key(rowgroup_key(addr_vec), addr_vec[int(T::Level::Row)]);
+        }
+
+        list<Request>::iterator push_back(Request req)
+        {
+            list<Request>::iterator itr;
+            if (free_nodes.empty())
+                itr = q.insert(q.end(), std::move(req));
+            else {
+                itr = free_nodes.begin();
+                q.splice(q.end(), free_nodes, itr);
+                *itr = std::move(req);
+            }
+            itr->queue_seq = next_seq++;
+            addrs[itr->addr]++;
+            rows[row_key(itr->addr_vec)].push_back(itr);
+            rowgroups[rowgroup_key(itr->addr_vec)].insert(itr);
+            return itr;
+        }
+
+        void erase(list<Request>::iterator req)
+        {
+            auto addr = addrs.find(req->addr);
+            if (--addr->second == 0)
+                addrs.erase(addr);
+
+            auto row = rows.find(row_key(req->addr_vec));
+            auto& reqs = row->second;
+            reqs.erase(find(reqs.begin(), reqs.end(), req));
+            if (reqs.empty())
+                rows.erase(row);
+
+            auto rowgroup = rowgroups.find(rowgroup_key(req->addr_vec));
+            rowgroup->second.erase(req);
+            if (rowgroup->second.empty())
+                rowgroups.erase(rowgroup);
+
+            free_nodes.splice(free_nodes.begin(), q, req);
+        }
+
+        bool contains(long addr) {return addrs.count(addr);}
+
+        // requests to the same row, nullptr if there are none
+        vector<list<Request>::iterator>* get_row(const AddrVec& addr_vec)
+        {
+            return get_row(rowgroup_key(addr_vec), addr_vec[int(T::Level::Row)]);
+        }
+
+        vector<list<Request>::iterator>* get_row(long rowgroup, int row)
+        {
+            auto itr = rows.find(row_key(rowgroup, row));
+            return itr == rows.end() ? nullptr : &itr->second;
+        }
     };
 
     Queue readq;  // queue for read requests
@@ -117,10 +211,19 @@ public:
     /* Command trace for DRAMPower 3.1 */
     string cmd_trace_prefix = "cmd-trace-";
     vector<ofstream> cmd_trace_files;
+    vector<unique_ptr<CmdTraceWriter>> cmd_trace_writers; // with cmd_trace_format = binary
     bool record_cmd_trace = false;
+    bool cmd_trace_bank_groups = false; // bank ids count the banks of the lower bank groups
     /* Commands to stdout */
     bool print_cmd_trace = false;
 
+    /* Power trace, a CSV row per rank every dpower_period cycles (see update_DPower) */
+    FILE* power_trace = nullptr;
+    long dpower_period = DPOWER_UPDATE_PERIOD;
+    long power_epoch_start = 0;
+    double tCK = 0; // ns
+    vector<long> epoch_read_bytes, epoch_write_bytes, epoch_activates, epoch_activated_sectors;
+
     /* Sectored DRAM */
     bool sectoredDRAM = false;
     bool dynamicOn = false;
@@ -130,7 +233,7 @@ public:
     long int waitAddress = -1;
     bool debug = false;
 
-    int tFAW_budget = 0;
+    vector<FAWTracker> faw_trackers; // sector-weighted tFAW of each rank
 
     std::vector<libDRAMPower> dpower;
     bool dpower_is_reset = false;
@@ -143,13 +246,12 @@ public:
 
     bool dynamic_policy = false;
 
-    typedef struct 
-    {
-        long tick;
-        int sectors;
-    } faw_entry;
+    /* Event-driven clock skipping */
+    long last_state_change = -1; // last clk at which a tick or an enqueue changed the controller state
+    long last_sched_clk = -1; // last clk at which the controller was allowed to schedule a command
+    int last_sched_faw_stall = -1; // the rank whose tFAW stalled that tick, -1 if none
 
-    queue <faw_entry> faw_queue;
+    static const long DPOWER_UPDATE_PERIOD = 50000000;
 
     /* Constructor */
     Controller(const Config& configs, DRAM<T>* channel) :
@@ -173,6 +275,17 @@ public:
         assert(!sectoredDRAMSALP && "not guaranteed to work yet");
         sector_size = configs.get_sector_size();
 
+        if (configs.contains("scheduler")) {
+            auto name = scheduler->name_to_type.find(configs["scheduler"]);
+            if (name == scheduler->name_to_type.end()) {
+                cerr << "Unknown scheduler: " << configs["scheduler"] << endl;
+                exit(1);
+            }
+            scheduler->type = name->second;
+        }
+        scheduler->cap = configs.get_scheduler_cap();
+        scheduler->init_cores(configs.get_core_num());
+
         // Yanked from Hassan
         // Initialize DRAM Power
         DRAMPower::MemorySpecification memSpec(DRAMPower::MemSpecParser::getMemSpecFromXML(configs.get_dpower_config_path()));
@@ -189,10 +302,12 @@ public:
         // CB size/sector_size = # of sectors
         // multiply by four because we can issue up 
         // to four activates within this window
+        int tFAW_budget = 4;
         if (sectoredDRAM || partialActivationDRAM || fgDRAM || halfDRAM)
             tFAW_budget = (64/sector_size) * 4;
-        else
-            tFAW_budget = 4;
+        // the window cannot be shorter than four ACTs at tRRD_S
+        long tFAW = max(channel->spec->speed_entry.nFAW, 4 * channel->spec->speed_entry.nRRDS);
+        faw_trackers.assign(channel->spec->org_entry.count[int(T::Level::Rank)], FAWTracker(tFAW, tFAW_budget));
 
 
         record_cmd_trace = configs.record_cmd_trace();
@@ -203,8 +318,34 @@ public:
             }
             string prefix = cmd_trace_prefix + "chan-" + to_string(channel->id) + "-rank-";
             string suffix = ".cmdtrace";
-            for (unsigned int i = 0; i < channel->children.size(); i++)
-                cmd_trace_files[i].open(prefix + to_string(i) + suffix);
+            cmd_trace_bank_groups = channel->spec->standard_name == "DDR4" || channel->spec->standard_name == "GDDR5";
+            if (configs["cmd_trace_format"] == "binary") {
+                vector<string> command_names(channel->spec->command_name, channel->spec->command_name + int(T::Command::MAX));
+                for (unsigned int i = 0; i < channel->children.size(); i++)
+                    cmd_trace_writers.emplace_back(new CmdTraceWriter(prefix + to_string(i) + suffix + ".bin", command_names));
+            } else {
+                for (unsigned int i = 0; i < channel->children.size(); i++)
+                    cmd_trace_files[i].open(prefix + to_string(i) + suffix);
+            }
+        }
+
+        tCK = memSpec.memTimingSpec.clkPeriod;
+        int ranks = channel->spec->org_entry.count[int(T::Level::Rank)];
+        epoch_read_bytes.assign(ranks, 0);
+        epoch_write_bytes.assign(ranks, 0);
+        epoch_activates.assign(ranks, 0);
+        epoch_activated_sectors.assign(ranks, 0);
+        if (configs["power_trace"] != "") {
+            string fname = configs["power_trace"] + "chan-" + to_string(channel->id) + ".csv";
+            power_trace = fopen(fname.c_str(), "w");
+            if (!power_trace) {
+                fprintf(stderr, "Cannot create the power trace %s\n", fname.c_str());
+                exit(1);
+            }
+            fprintf(power_trace, "cycle,rank,act_mJ,pre_mJ,rd_mJ,wr_mJ,ref_mJ,act_stdby_mJ,pre_stdby_mJ,io_term_mJ,"
+                "total_mJ,avg_power_mW,read_bytes,write_bytes,bandwidth_GBps,activates,activated_sectors\n");
+            dpower_period = configs.get_power_epoch();
+            assert(dpower_period > 0);
         }
 
         dynamic_policy = configs.is_dynamic_policy();
@@ -350,6 +491,12 @@ public:
             .desc("Total number of cycles wasted because FAW was unsatisfied")
             .precision(0)
             ;
+        faw_penalty_cycles_rank
+            .init(faw_trackers.size())
+            .name("faw_penalty_cycles_rank"+to_string(channel->id))
+            .desc("Number of cycles wasted because FAW was unsatisfied per rank")
+            .precision(0)
+            ;
 
 #ifndef INTEGRATED_WITH_GEM5
         record_read_hits
@@ -467,6 +614,8 @@ public:
         for (auto& file : cmd_trace_files)
             file.close();
         cmd_trace_files.clear();
+        if (power_trace)
+            fclose(power_trace);
     }
 
     void setProc(Processor* proc) {this->proc = proc;}
@@ -501,16 +650,48 @@ void update_DPower(const bool finish = false) {
 
             dpower_total_energy[rank_id] += dpower[rank_id].getEnergy().window_energy/1000000000;
 
+            if (power_trace)
+                write_power_trace(rank_id);
+
             if (finish) {
                 dpower[rank_id].calcEnergy();
                 dpower_avg_power[rank_id] = dpower[rank_id].getPower().average_power;
             }
         }
+        start_power_epoch();
     }
 
     void discard_DPowerWindow() {
         for (uint32_t rank_id = 0; rank_id < (uint32_t)channel->spec->org_entry.count[int(T::Level::Rank)]; rank_id++)
             dpower[rank_id].calcWindowEnergy(clk);
+        start_power_epoch();
+    }
+
+    // energies of the last DRAMPower window, with the traffic of the rank in it
+    void write_power_trace(uint32_t rank_id) {
+        const auto& energy = dpower[rank_id].getEnergy();
+        double ns = (clk - power_epoch_start) * tCK;
+        if (ns <= 0)
+            return;
+        fprintf(power_trace, "%ld,%u,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%ld,%ld,%.3f,%ld,%ld\n",
+            clk, rank_id,
+            energy.act_energy/1000000000, energy.pre_energy/1000000000,
+            energy.read_energy/1000000000, energy.write_energy/1000000000,
+            energy.ref_energy/1000000000,
+            energy.act_stdby_energy/1000000000, energy.pre_stdby_energy/1000000000,
+            energy.io_term_energy/1000000000, energy.window_energy/1000000000,
+            energy.window_energy/ns, // pJ/ns is mW
+            epoch_read_bytes[rank_id], epoch_write_bytes[rank_id],
+            (epoch_read_bytes[rank_id] + epoch_write_bytes[rank_id])/ns, // bytes/ns is GB/s
+            epoch_activates[rank_id], epoch_activated_sectors[rank_id]);
+    }
+
+    void start_power_epoch() {
+        power_epoch_start = clk;
+        fill(epoch_read_bytes.begin(), epoch_read_bytes.end(), 0);
+        fill(epoch_write_bytes.begin(), epoch_write_bytes.end(), 0);
+        fill(epoch_activates.begin(), epoch_activates.end(), 0);
+        fill(epoch_activated_sectors.begin(), epoch_activated_sectors.end(), 0);
     }
 
     /* Member Functions */
@@ -544,29 +725,25 @@ void update_DPower(const bool finish = false) {
         if (sectoredDRAM)
         {
             // try to make earlier requests open later requests' sectors too
-            for (Request& existing_req : queue.q)
-            {
-                if ((req.addr_vec[int(T::Level::Rank)] == existing_req.addr_vec[int(T::Level::Rank)]) &&
-                    (req.addr_vec[int(T::Level::BankGroup)] == existing_req.addr_vec[int(T::Level::BankGroup)]) &&
-                    (req.addr_vec[int(T::Level::Bank)] == existing_req.addr_vec[int(T::Level::Bank)]) &&
-                    (req.addr_vec[int(T::Level::Row)] == existing_req.addr_vec[int(T::Level::Row)]))
-                existing_req.sector_bits[4] |= req.sector_bits[4];
-            }
+            auto same_row = queue.get_row(req.addr_vec);
+            if (same_row)
+                for (auto existing_req : *same_row)
+                    existing_req->sector_bits[4] |= req.sector_bits[4];
         }
 
         req.arrive = clk;
-        queue.q.push_back(req);
+        auto queued_req = queue.push_back(req);
+        last_state_change = clk;
 
         if (sectoredDRAM && (sector_size == 8) && (req.type != Request::Type::REFRESH))
             assert(req.sector_bits[3] < 256);
 
         // shortcut for read requests, if a write to same addr exists
         // necessary for coherence
-        if ((req.type == Request::Type::READ || req.type == Request::Type::PREFETCH) && find_if(writeq.q.begin(), writeq.q.end(),
-                [req](Request& wreq){ return req.addr == wreq.addr;}) != writeq.q.end()){
+        if ((req.type == Request::Type::READ || req.type == Request::Type::PREFETCH) && writeq.contains(req.addr)){
             req.depart = clk + 1;
             pending.push_back(req);
-            readq.q.pop_back();
+            readq.erase(queued_req);
         }
         return true;
     }
@@ -575,17 +752,124 @@ void update_DPower(const bool finish = false) {
 
     
 
+    // The earliest clk at which a tick might do something other than repeating
+    // the outcome of the last scheduling tick, i.e., all ticks before it only
+    // accumulate per-cycle statistics and can be skipped (see skip()).
+    long next_event()
+    {
+        // the last scheduling decision has to be made on the current state
+        if (last_sched_clk <= last_state_change)
+            return clk + 1;
+        if (warmup_complete && !dpower_is_reset)
+            return clk + 1;
+
+        long next = (clk + 1) / dpower_period * dpower_period + dpower_period - 1;
+        if (dynamic_policy)
+            next = min(next, (clk / 1000 + 1) * 1000);
+        next = min(next, scheduler->next_event());
+        if (pending.size())
+            next = min(next, pending.front().depart);
+        next = min(next, clk + refresh->get_next() - refresh->clk);
+
+        // requests whose first command becomes ready change the scheduling decision
+        for (Queue* queue : {&actq, &readq, &writeq, &otherq}) {
+            for (auto req = queue->q.begin(); req != queue->q.end(); ++req) {
+                get_first_cmd(req);
+                long ready = req->cmd_cache.ready;
+                if (ready > last_sched_clk)
+                    next = min(next, ready);
+                // and those whose ACT comes to fit in the tFAW window
+                long faw_ready = get_faw_ready(req);
+                if (faw_ready > last_sched_clk)
+                    next = min(next, faw_ready);
+            }
+        }
+        if (rowpolicy->type != RowPolicy<T>::Type::Opened) {
+            for (int id = 0; id < int(rowtable->table.size()); id++) {
+                if (!rowtable->is_open(id))
+                    continue;
+                long ready = channel->get_next(T::Command::PRE, rowtable->rowgroups[id].data());
+                if (rowpolicy->type == RowPolicy<T>::Type::Timeout)
+                    ready = max(ready, rowtable->table[id].timestamp + rowpolicy->timeout);
+                if (ready > last_sched_clk)
+                    next = min(next, ready);
+            }
+        }
+
+        return max(next, clk + 1);
+    }
+
+    // Fast-forward over idle cycles, crediting what tick() would have accumulated
+    // sched_cycles of them are cycles in which the controller may schedule
+    void skip(long cycles, long sched_cycles)
+    {
+        clk += cycles;
+        refresh->clk += cycles;
+        req_queue_length_sum += cycles * (readq.size() + writeq.size() + pending.size());
+        read_req_queue_length_sum += cycles * (readq.size() + pending.size());
+        write_req_queue_length_sum += cycles * writeq.size();
+        rolling_sum_queue_length += cycles * (readq.size() + pending.size());
+        if (last_sched_faw_stall >= 0) {
+            faw_penalty_cycles += sched_cycles;
+            faw_penalty_cycles_rank[last_sched_faw_stall] += sched_cycles;
+        }
+    }
+
     inline int count_activated_sectors(ulong sector_bits){
         return __builtin_popcountll(sector_bits);
     }
 
+    // The tFAW budget an ACT for a request of this type takes
+    int activated_sectors(Request::Type type, ulong sector_bits)
+    {
+        if (!(sectoredDRAM || partialActivationDRAM || fgDRAM || halfDRAM))
+            return 1;
+
+        int acts = count_activated_sectors(sector_bits);
+
+        if (partialActivationDRAM)
+            if (type == Request::Type::READ)
+                acts = 64/sector_size;
+
+        if (fgDRAM)
+            acts = 1; // always opens one sector
+
+        if (halfDRAM)
+            acts = 64/sector_size/2; // always opens half a row
+
+        if (sectoredDRAM && burstChopDRAM)
+            acts = 64/sector_size;
+
+        return acts;
+    }
+
+    FAWTracker& get_faw_tracker(list<Request>::iterator req)
+    {
+        return faw_trackers[req->addr_vec[int(T::Level::Rank)]];
+    }
+
+    // The earliest clk at which the tFAW window of its rank allows the first
+    // command of req, if that is an ACT
+    long get_faw_ready(list<Request>::iterator req)
+    {
+        if (get_first_cmd(req) != T::Command::ACT)
+            return clk;
+        return get_faw_tracker(req).get_next(clk, activated_sectors(req->type, req->sector_bits[4]));
+    }
+
+    // false if the first command of req is an ACT that exceeds the tFAW budget
+    bool fits_faw_budget(list<Request>::iterator req)
+    {
+        return get_faw_ready(req) <= clk;
+    }
+
     bool is_ready(list<Request>::iterator req)
     {
-        typename T::Command cmd = get_first_cmd(req);
-        return channel->check(cmd, req->addr_vec.data(), clk);
+        get_first_cmd(req);
+        return req->cmd_cache.ready <= clk;
     }
 
-    bool is_ready(typename T::Command cmd, const vector<int>& addr_vec)
+    bool is_ready(typename T::Command cmd, const AddrVec& addr_vec)
     {
         return channel->check(cmd, addr_vec.data(), clk);
     }
@@ -604,7 +888,7 @@ void update_DPower(const bool finish = false) {
         return channel->check_sector_miss(cmd, req->addr_vec.data(), req->sector_bits[3]);
     }
 
-    bool is_row_hit(typename T::Command cmd, const vector<int>& addr_vec)
+    bool is_row_hit(typename T::Command cmd, const AddrVec& addr_vec)
     {
         return channel->check_row_hit(cmd, addr_vec.data(), 0UL);
     }
@@ -616,7 +900,7 @@ void update_DPower(const bool finish = false) {
         return channel->check_row_open(cmd, req->addr_vec.data());
     }
 
-    bool is_row_open(typename T::Command cmd, const vector<int>& addr_vec)
+    bool is_row_open(typename T::Command cmd, const AddrVec& addr_vec)
     {
         return channel->check_row_open(cmd, addr_vec.data());
     }
@@ -655,45 +939,69 @@ void update_DPower(const bool finish = false) {
     }
 
 private:
+    // incremented whenever a command changes the state or the timing of the channel
+    long cmd_version = 0;
+
     typename T::Command get_first_cmd(list<Request>::iterator req)
     {
-        typename T::Command cmd = channel->spec->translate[int(req->type)];
-        return channel->decode(cmd, req->addr_vec.data(), req->sector_bits[3]); // Hint to Nisa: this will need to change once we impl. sector bit accumulation technique
+        auto& cache = req->cmd_cache;
+        if (cache.version != cmd_version) {
+            // the first command only depends on the state of the bank, and
+            // of the rank for requests without a bank (e.g., refresh)
+            long state_version = rowtable->get_version(req->addr_vec);
+            if (state_version < 0)
+                state_version = cmd_version;
+            if (cache.state_version != state_version) {
+                typename T::Command cmd = channel->spec->translate[int(req->type)];
+                cmd = channel->decode(cmd, req->addr_vec.data(), req->sector_bits[3]); // Hint to Nisa: this will need to change once we impl. sector bit accumulation technique
+                cache.cmd = int(cmd);
+                cache.state_version = state_version;
+            }
+            cache.ready = channel->get_next(typename T::Command(cache.cmd), req->addr_vec.data());
+            cache.version = cmd_version;
+        }
+        return typename T::Command(cache.cmd);
+    }
+
+    // Opens the sectors of all queued requests to the row of req with its
+    // ACT, so that they do not need a re-activation of their own, unless
+    // that exceeds the tFAW budget
+    void merge_row_sectors(list<Request>::iterator req)
+    {
+        ulong sectors = req->sector_bits[4];
+        for (Queue* queue : {&actq, &readq, &writeq}) {
+            auto same_row = queue->get_row(req->addr_vec);
+            if (same_row)
+                for (auto itr : *same_row)
+                    sectors |= itr->sector_bits[4];
+        }
+        if (get_faw_tracker(req).fits(clk, activated_sectors(req->type, sectors)))
+            req->sector_bits[4] = sectors;
     }
 
     // upgrade to an autoprecharge command
     void cmd_issue_autoprecharge(typename T::Command& cmd,
-                                            const vector<int>& addr_vec) {
+                                            const AddrVec& addr_vec) {
 
         // currently, autoprecharge is only used with closed row policy
         if(channel->spec->is_accessing(cmd) && rowpolicy->type == RowPolicy<T>::Type::ClosedAP) {
             // check if it is the last request to the opened row
             Queue* queue = write_mode ? &writeq : &readq;
 
-            auto begin = addr_vec.begin();
-            vector<int> rowgroup(begin, begin + int(T::Level::Row) + 1);
-
 			int num_row_hits = 0;
 
-            for (auto itr = queue->q.begin(); itr != queue->q.end(); ++itr) {
-                if (is_row_hit(itr)) { 
-                    auto begin2 = itr->addr_vec.begin();
-                    vector<int> rowgroup2(begin2, begin2 + int(T::Level::Row) + 1);
-                    if(rowgroup == rowgroup2)
+            auto same_row = queue->get_row(addr_vec);
+            if (same_row)
+                for (auto itr : *same_row)
+                    if (is_row_hit(itr))
                         num_row_hits++;
-                }
-            }
 
             if(num_row_hits == 0) {
-                Queue* queue = &actq;
-                for (auto itr = queue->q.begin(); itr != queue->q.end(); ++itr) {
-                    if (is_row_hit(itr)) {
-                        auto begin2 = itr->addr_vec.begin();
-                        vector<int> rowgroup2(begin2, begin2 + int(T::Level::Row) + 1);
-                        if(rowgroup == rowgroup2)
+                same_row = actq.get_row(addr_vec);
+                if (same_row)
+                    for (auto itr : *same_row)
+                        if (is_row_hit(itr))
                             num_row_hits++;
-                    }
-                }
             }
 
             assert(num_row_hits > 0); // The current request should be a hit, 
@@ -759,13 +1067,13 @@ private:
 
         if ((dpower_cmd == DRAMPower::MemCommand::RD || dpower_cmd == DRAMPower::MemCommand::WR) && fgDRAM)
             for (int i = 0 ; i < 64/sector_size ; i++)
-                dpower[rank_id].doCommand(dpower_cmd, gbid, clk + i * channel->spec->get_nRRDL() / (64/sector_size), sector_bits);
+                dpower[rank_id].doCommand(dpower_cmd, gbid, clk + i * channel->spec->get_nRRDL() / (64/sector_size), sector_bits, clk);
         else
             dpower[rank_id].doCommand(dpower_cmd, gbid, clk, sector_bits);
     }
 
 
-    void issue_cmd(typename T::Command cmd, const vector<int>& addr_vec, ulong sector_bits)
+    void issue_cmd(typename T::Command cmd, const AddrVec& addr_vec, ulong sector_bits)
     {
         // TODO: This can cause problems when we are evaluating related work
         if (!(sectoredDRAM || partialActivationDRAM || fgDRAM || halfDRAM))
@@ -774,6 +1082,8 @@ private:
         cmd_issue_autoprecharge(cmd, addr_vec);
         assert(is_ready(cmd, addr_vec));
         channel->update(cmd, addr_vec.data(), clk, sector_bits);
+        cmd_version++;
+        last_state_change = clk;
 
         if (fgDRAM)
             sector_bits = 1; // always opens and reads from a single sector
@@ -782,23 +1092,34 @@ private:
             sector_bits = (1 << (64/sector_size/2)) - 1;
 
         issueDPowerCommand(cmd, addr_vec[int(T::Level::Rank)], addr_vec[int(T::Level::BankGroup)] * 4 + addr_vec[int(T::Level::Bank)], sector_bits);
+        if (cmd == T::Command::ACT) {
+            epoch_activates[addr_vec[int(T::Level::Rank)]]++;
+            // no sector bits activate all eight sectors (see libDRAMPower::doCommand)
+            epoch_activated_sectors[addr_vec[int(T::Level::Rank)]] += sector_bits ? __builtin_popcountl(sector_bits) : 8;
+        }
  
         if (record_cmd_trace){
-            // select rank
-            auto& file = cmd_trace_files[addr_vec[1]];
-            string& cmd_name = channel->spec->command_name[int(cmd)];
-            file<<clk<<','<<cmd_name;
-            // TODO bad coding here
-            if (cmd_name == "PREA" || cmd_name == "REF")
-                file<<endl;
-            else{
-                int bank_id = addr_vec[int(T::Level::Bank)];
-                if (channel->spec->standard_name == "DDR4" || channel->spec->standard_name == "GDDR5")
-                    bank_id += addr_vec[int(T::Level::Bank) - 1] * channel->spec->org_entry.count[int(T::Level::Bank)];
-                if (cmd_name == "PRA") 
-                    file << ","<<bank_id << "," << sector_bits << endl;
+            int bank_id = addr_vec[int(T::Level::Bank)];
+            if (cmd_trace_bank_groups)
+                bank_id += addr_vec[int(T::Level::Bank) - 1] * channel->spec->org_entry.count[int(T::Level::Bank)];
+            if (!cmd_trace_writers.empty()) {
+                // only an ACT (PRA in DDR4) records its sectors
+                if (cmd != T::Command::ACT)
+                    sector_bits = 0;
+                assert(sector_bits < 256);
+                cmd_trace_writers[addr_vec[1]]->write(clk, int(cmd), bank_id, sector_bits);
+            } else {
+                // select rank
+                auto& file = cmd_trace_files[addr_vec[1]];
+                string& cmd_name = channel->spec->command_name[int(cmd)];
+                file<<clk<<','<<cmd_name;
+                // TODO bad coding here
+                if (cmd_name == "PREA" || cmd_name == "REF")
+                    file<<'\n';
+                else if (cmd_name == "PRA")
+                    file << ","<<bank_id << "," << sector_bits << '\n';
                 else
-                    file<<','<<bank_id<<endl;
+                    file<<','<<bank_id<<'\n';
             }
         }
         if (print_cmd_trace){
@@ -819,12 +1140,27 @@ private:
         rowtable->update(cmd, addr_vec, clk);
 
     }
-    vector<int> get_addr_vec(typename T::Command cmd, list<Request>::iterator req){
+    AddrVec get_addr_vec(typename T::Command cmd, list<Request>::iterator req){
         return req->addr_vec;
     }
 
     public:
     void tick(bool can_schedule);
+
+    // While the channel is ticked on a worker thread (see Memory::tick),
+    // completed requests and processor notifications are kept here and
+    // handed over by run_deferred() on the simulation thread.
+    bool defer_callbacks = false;
+    void run_deferred();
+
+    void checkpoint(Checkpoint& ckpt)
+    {
+        ckpt.io(dynamicOn);
+    }
+
+    private:
+    vector<Request> completed;
+    int sector_dram_switch = 0; // 1: turn Sectored DRAM on, -1: off
 };
 } /*namespace ramulator*/
 
@@ -123,7 +123,7 @@ void DDR4::init_speed()
 
     speed_entry.nRRDS = RRDS_TABLE[org_entry.dq == 16? 1: 0][speed];
     speed_entry.nRRDL = RRDL_TABLE[org_entry.dq == 16? 1: 0][speed];
-    speed_entry.nFAW =  0; //FAW_TABLE[org_entry.dq == 4? 0: org_entry.dq == 8? 1: 2][speed]; // TODO: set faw value
+    speed_entry.nFAW = FAW_TABLE[org_entry.dq == 4? 0: org_entry.dq == 8? 1: 2][speed];
     speed_entry.nRFC = RFC_TABLE[(int)refresh_mode][density][speed];
     speed_entry.nREFI = (REFI_TABLE[speed] >> int(refresh_mode));
     speed_entry.nXS = XS_TABLE[density][speed];
@@ -160,174 +160,61 @@ int DDR4::get_nRRDL()
 void DDR4::init_prereq()
 {
     // RD
-    prereq[int(Level::Rank)][int(Command::RD)] = [] (DRAM<DDR4>* node, Command cmd, int id, ulong sectors) {
-        switch (int(node->state)) {
-            case int(State::PowerUp): return Command::MAX;
-            case int(State::ActPowerDown): return Command::PDX;
-            case int(State::PrePowerDown): return Command::PDX;
-            case int(State::SelfRefresh): return Command::SRX;
-            default: assert(false);
-        }};
-    prereq[int(Level::Bank)][int(Command::RD)] = [] (DRAM<DDR4>* node, Command cmd, int id, ulong sectors) {
-        switch (int(node->state)) {
-            case int(State::Closed): return Command::ACT;
-            case int(State::Opened):
-                if (node->row_state.find(id) != node->row_state.end())
-                {
-                    if (node->sectors == 0UL) // can only happen when we are evaluating other stuff
-                        return cmd;
-                    else if ((~node->sectors) & sectors) // not enough sectors are open for us to handle this request
-                        return Command::PRE;
-                    else
-                        return cmd;
-                }
-                else return Command::PRE;
-            default: assert(false);
-        }};
+    prereq[int(Level::Rank)][int(Command::RD)] = prereq_rank;
+    prereq[int(Level::Bank)][int(Command::RD)] = prereq_bank;
 
     // WR
-    prereq[int(Level::Rank)][int(Command::WR)] = prereq[int(Level::Rank)][int(Command::RD)];
-    prereq[int(Level::Bank)][int(Command::WR)] = prereq[int(Level::Bank)][int(Command::RD)];
+    prereq[int(Level::Rank)][int(Command::WR)] = prereq_rank;
+    prereq[int(Level::Bank)][int(Command::WR)] = prereq_bank;
 
     // REF
-    prereq[int(Level::Rank)][int(Command::REF)] = [] (DRAM<DDR4>* node, Command cmd, int id, ulong sectors) {
-        for (auto bg : node->children)
-            for (auto bank: bg->children) {
-                if (bank->state == State::Closed)
-                    continue;
-                return Command::PREA;
-            }
-        return Command::REF;};
+    prereq[int(Level::Rank)][int(Command::REF)] = prereq_rank;
 
     // PD
-    prereq[int(Level::Rank)][int(Command::PDE)] = [] (DRAM<DDR4>* node, Command cmd, int id, ulong sectors) {
-        switch (int(node->state)) {
-            case int(State::PowerUp): return Command::PDE;
-            case int(State::ActPowerDown): return Command::PDE;
-            case int(State::PrePowerDown): return Command::PDE;
-            case int(State::SelfRefresh): return Command::SRX;
-            default: assert(false);
-        }};
+    prereq[int(Level::Rank)][int(Command::PDE)] = prereq_rank;
 
     // SR
-    prereq[int(Level::Rank)][int(Command::SRE)] = [] (DRAM<DDR4>* node, Command cmd, int id, ulong sectors) {
-        switch (int(node->state)) {
-            case int(State::PowerUp): return Command::SRE;
-            case int(State::ActPowerDown): return Command::PDX;
-            case int(State::PrePowerDown): return Command::PDX;
-            case int(State::SelfRefresh): return Command::SRE;
-            default: assert(false);
-        }};
+    prereq[int(Level::Rank)][int(Command::SRE)] = prereq_rank;
 }
 
 // SAUGATA: added row hit check functions to see if the desired location is currently open
 void DDR4::init_rowhit()
 {
     // RD
-    rowhit[int(Level::Bank)][int(Command::RD)] = [] (DRAM<DDR4>* node, Command cmd, int id, ulong sectors) {
-        switch (int(node->state)) {
-            case int(State::Closed): return false;
-            case int(State::Opened):
-                if (node->row_state.find(id) != node->row_state.end())
-                {
-                    if (node->sectors == 0UL)
-                        return true; // only is the case for baseline and etc designs
-                    else if ((~node->sectors) & sectors) // not enough sectors are open for us to handle this request
-                        return false;
-                    else
-                        return true;
-                }
-                return false;
-            default: assert(false);
-        }};
+    rowhit[int(Level::Bank)][int(Command::RD)] = rowhit_bank;
 
     // WR
-    rowhit[int(Level::Bank)][int(Command::WR)] = rowhit[int(Level::Bank)][int(Command::RD)];
+    rowhit[int(Level::Bank)][int(Command::WR)] = rowhit_bank;
 }
 
 void DDR4::init_sectormiss()
 {
     // RD
-    sectormiss[int(Level::Bank)][int(Command::RD)] = [] (DRAM<DDR4>* node, Command cmd, int id, ulong sectors) {
-        switch (int(node->state)) {
-            case int(State::Closed): return false;
-            case int(State::Opened):
-                if (node->row_state.find(id) != node->row_state.end())
-                {
-                    if (node->sectors == 0UL)
-                        return false; // only is the case for baseline and etc designs
-                    else if ((~node->sectors) & sectors) // not enough sectors are open for us to handle this request
-                    {
-                        return true;
-                    }
-                    else
-                        return false;
-                }
-                return false;
-            default: assert(false);
-        }};
+    sectormiss[int(Level::Bank)][int(Command::RD)] = sectormiss_bank;
 
     // WR
-    sectormiss[int(Level::Bank)][int(Command::WR)] = rowhit[int(Level::Bank)][int(Command::RD)];
+    sectormiss[int(Level::Bank)][int(Command::WR)] = sectormiss_bank;
 }
 
 void DDR4::init_rowopen()
 {
     // RD
-    rowopen[int(Level::Bank)][int(Command::RD)] = [] (DRAM<DDR4>* node, Command cmd, int id) {
-        switch (int(node->state)) {
-            case int(State::Closed): return false;
-            case int(State::Opened): return true;
-            default: assert(false);
-        }};
+    rowopen[int(Level::Bank)][int(Command::RD)] = rowopen_bank;
 
     // WR
-    rowopen[int(Level::Bank)][int(Command::WR)] = rowopen[int(Level::Bank)][int(Command::RD)];
+    rowopen[int(Level::Bank)][int(Command::WR)] = rowopen_bank;
 }
 
 void DDR4::init_lambda()
 {
-    lambda[int(Level::Bank)][int(Command::ACT)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        node->state = State::Opened;
-        node->sectors = sectors;
-        node->row_state[id] = State::Opened;};
-    lambda[int(Level::Bank)][int(Command::PRE)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        node->state = State::Closed;
-        node->sectors = 0UL;
-        node->row_state.clear();};
-    lambda[int(Level::Rank)][int(Command::PREA)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        for (auto bg : node->children)
-            for (auto bank : bg->children) {
-                bank->state = State::Closed;
-                bank->sectors = 0UL;
-                bank->row_state.clear();
-            }};
-    lambda[int(Level::Rank)][int(Command::REF)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {};
-    lambda[int(Level::Bank)][int(Command::RD)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {};
-    lambda[int(Level::Bank)][int(Command::WR)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {};
-    lambda[int(Level::Bank)][int(Command::RDA)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        node->state = State::Closed;
-        node->sectors = 0UL;
-        node->row_state.clear();};
-    lambda[int(Level::Bank)][int(Command::WRA)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        node->state = State::Closed;
-        node->sectors = 0UL;
-        node->row_state.clear();};
-    lambda[int(Level::Rank)][int(Command::PDE)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        for (auto bg : node->children)
-            for (auto bank : bg->children) {
-                if (bank->state == State::Closed)
-                    continue;
-                node->state = State::ActPowerDown;
-                return;
-            }
-        node->state = State::PrePowerDown;};
-    lambda[int(Level::Rank)][int(Command::PDX)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        node->state = State::PowerUp;};
-    lambda[int(Level::Rank)][int(Command::SRE)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        node->state = State::SelfRefresh;};
-    lambda[int(Level::Rank)][int(Command::SRX)] = [] (DRAM<DDR4>* node, int id, ulong sectors) {
-        node->state = State::PowerUp;};
+    for (Command cmd : {Command::ACT, Command::PRE, Command::RD, Command::WR, Command::RDA, Command::WRA}) {
+        lambda[int(Level::Bank)][int(cmd)] = [cmd] (DRAM<DDR4>* node, int id, ulong sectors) {
+            lambda_bank(node, cmd, id, sectors);};
+    }
+    for (Command cmd : {Command::PREA, Command::REF, Command::PDE, Command::PDX, Command::SRE, Command::SRX}) {
+        lambda[int(Level::Rank)][int(cmd)] = [cmd] (DRAM<DDR4>* node, int id, ulong sectors) {
+            lambda_rank(node, cmd, id, sectors);};
+    }
 }
 
 
@@ -406,7 +293,8 @@ void DDR4::init_timing()
 
     // RAS <-> RAS
     t[int(Command::ACT)].push_back({Command::ACT, 1, s.nRRDS});
-    t[int(Command::ACT)].push_back({Command::ACT, 4, s.nFAW});
+    // ACT <-> ACT (tFAW): enforced by the controller per rank, weighted by
+    // the activated sectors (see FAWTracker)
     t[int(Command::ACT)].push_back({Command::PREA, 1, s.nRAS});
     t[int(Command::PREA)].push_back({Command::ACT, 1, s.nRP});
 
@@ -136,6 +136,16 @@ public:
     /* Lambda */
     function<void(DRAM<DDR4>*, int, ulong)> lambda[int(Level::MAX)][int(Command::MAX)];
 
+    /* Per-level implementations of the tables above. DRAM<DDR4> calls them
+     * directly (see the end of this file) instead of going through std::function. */
+    static Command prereq_rank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors);
+    static Command prereq_bank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors);
+    static bool rowhit_bank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors);
+    static bool sectormiss_bank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors);
+    static bool rowopen_bank(DRAM<DDR4>* node, Command cmd, int id);
+    static void lambda_rank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors);
+    static void lambda_bank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors);
+
     /* Organization */
     enum class Org : int
     {
@@ -221,6 +231,260 @@ private:
     void init_timing();
 };
 
+inline DDR4::Command DDR4::prereq_rank(DRAM<DDR4>* node, Command cmd, int, ulong)
+{
+    switch (int(cmd)) {
+        case int(Command::RD):
+        case int(Command::WR):
+            switch (int(node->state)) {
+                case int(State::PowerUp): return Command::MAX;
+                case int(State::ActPowerDown): return Command::PDX;
+                case int(State::PrePowerDown): return Command::PDX;
+                case int(State::SelfRefresh): return Command::SRX;
+                default: assert(false);
+            }
+            break;
+        case int(Command::REF):
+            for (auto bg : node->children)
+                for (auto bank: bg->children) {
+                    if (bank->state == State::Closed)
+                        continue;
+                    return Command::PREA;
+                }
+            return Command::REF;
+        case int(Command::PDE):
+            switch (int(node->state)) {
+                case int(State::PowerUp): return Command::PDE;
+                case int(State::ActPowerDown): return Command::PDE;
+                case int(State::PrePowerDown): return Command::PDE;
+                case int(State::SelfRefresh): return Command::SRX;
+                default: assert(false);
+            }
+            break;
+        case int(Command::SRE):
+            switch (int(node->state)) {
+                case int(State::PowerUp): return Command::SRE;
+                case int(State::ActPowerDown): return Command::PDX;
+                case int(State::PrePowerDown): return Command::PDX;
+                case int(State::SelfRefresh): return Command::SRE;
+                default: assert(false);
+            }
+            break;
+    }
+    return Command::MAX;
+}
+
+inline DDR4::Command DDR4::prereq_bank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors)
+{
+    if (cmd != Command::RD && cmd != Command::WR)
+        return Command::MAX;
+
+    switch (int(node->state)) {
+        case int(State::Closed): return Command::ACT;
+        case int(State::Opened):
+            if (node->row_state.find(id) != node->row_state.end())
+            {
+                if (node->sectors == 0UL) // can only happen when we are evaluating other stuff
+                    return cmd;
+                else if ((~node->sectors) & sectors) // not enough sectors are open for us to handle this request
+                    return Command::PRE;
+                else
+                    return cmd;
+            }
+            else return Command::PRE;
+        default: assert(false);
+    }
+    return Command::MAX;
+}
+
+// SAUGATA: added row hit check functions to see if the desired location is currently open
+inline bool DDR4::rowhit_bank(DRAM<DDR4>* node, Command, int id, ulong sectors)
+{
+    switch (int(node->state)) {
+        case int(State::Closed): return false;
+        case int(State::Opened):
+            if (node->row_state.find(id) != node->row_state.end())
+            {
+                if (node->sectors == 0UL)
+                    return true; // only is the case for baseline and etc designs
+                else if ((~node->sectors) & sectors) // not enough sectors are open for us to handle this request
+                    return false;
+                else
+                    return true;
+            }
+            return false;
+        default: assert(false);
+    }
+    return false;
+}
+
+inline bool DDR4::sectormiss_bank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors)
+{
+    // WR uses the row hit check (see init_sectormiss())
+    if (cmd == Command::WR)
+        return rowhit_bank(node, cmd, id, sectors);
+
+    switch (int(node->state)) {
+        case int(State::Closed): return false;
+        case int(State::Opened):
+            if (node->row_state.find(id) != node->row_state.end())
+            {
+                if (node->sectors == 0UL)
+                    return false; // only is the case for baseline and etc designs
+                else if ((~node->sectors) & sectors) // not enough sectors are open for us to handle this request
+                    return true;
+                else
+                    return false;
+            }
+            return false;
+        default: assert(false);
+    }
+    return false;
+}
+
+inline bool DDR4::rowopen_bank(DRAM<DDR4>* node, Command, int)
+{
+    switch (int(node->state)) {
+        case int(State::Closed): return false;
+        case int(State::Opened): return true;
+        default: assert(false);
+    }
+    return false;
+}
+
+inline void DDR4::lambda_rank(DRAM<DDR4>* node, Command cmd, int, ulong)
+{
+    switch (int(cmd)) {
+        case int(Command::PREA):
+            for (auto bg : node->children)
+                for (auto bank : bg->children) {
+                    bank->state = State::Closed;
+                    bank->sectors = 0UL;
+                    bank->row_state.clear();
+                }
+            break;
+        case int(Command::PDE):
+            for (auto bg : node->children)
+                for (auto bank : bg->children) {
+                    if (bank->state == State::Closed)
+                        continue;
+                    node->state = State::ActPowerDown;
+                    return;
+                }
+            node->state = State::PrePowerDown;
+            break;
+        case int(Command::PDX):
+        case int(Command::SRX):
+            node->state = State::PowerUp;
+            break;
+        case int(Command::SRE):
+            node->state = State::SelfRefresh;
+            break;
+    }
+}
+
+inline void DDR4::lambda_bank(DRAM<DDR4>* node, Command cmd, int id, ulong sectors)
+{
+    switch (int(cmd)) {
+        case int(Command::ACT):
+            node->state = State::Opened;
+            node->sectors = sectors;
+            node->row_state[id] = State::Opened;
+            break;
+        case int(Command::PRE):
+        case int(Command::RDA):
+        case int(Command::WRA):
+            node->state = State::Closed;
+            node->sectors = 0UL;
+            node->row_state.clear();
+            break;
+    }
+}
+
+/* DRAM<DDR4> tree walks, equivalent to the generic ones in DRAM.h */
+
+template <>
+inline DDR4::Command DRAM<DDR4>::decode(DDR4::Command cmd, const int* addr, ulong sectors)
+{
+    DRAM<DDR4>* node = this;
+    while (true) {
+        int child_id = addr[int(node->level)+1];
+        DDR4::Command prereq_cmd = DDR4::Command::MAX;
+        if (node->level == DDR4::Level::Rank)
+            prereq_cmd = DDR4::prereq_rank(node, cmd, child_id, sectors);
+        else if (node->level == DDR4::Level::Bank)
+            prereq_cmd = DDR4::prereq_bank(node, cmd, child_id, sectors);
+        if (prereq_cmd != DDR4::Command::MAX)
+            return prereq_cmd; // stop: there is a prerequisite at this level
+
+        if (child_id < 0 || !node->children.size())
+            return cmd; // stop: there were no prequisites at any level
+        node = node->children[child_id];
+    }
+}
+
+template <>
+inline bool DRAM<DDR4>::check_row_hit(DDR4::Command cmd, const int* addr, ulong sectors)
+{
+    DRAM<DDR4>* node = this;
+    while (true) {
+        int child_id = addr[int(node->level)+1];
+        if (node->level == DDR4::Level::Bank && (cmd == DDR4::Command::RD || cmd == DDR4::Command::WR))
+            return DDR4::rowhit_bank(node, cmd, child_id, sectors);
+
+        if (child_id < 0 || !node->children.size())
+            return false;
+        node = node->children[child_id];
+    }
+}
+
+template <>
+inline bool DRAM<DDR4>::check_sector_miss(DDR4::Command cmd, const int* addr, ulong sectors)
+{
+    DRAM<DDR4>* node = this;
+    while (true) {
+        int child_id = addr[int(node->level)+1];
+        if (node->level == DDR4::Level::Bank && (cmd == DDR4::Command::RD || cmd == DDR4::Command::WR))
+            return DDR4::sectormiss_bank(node, cmd, child_id, sectors);
+
+        if (child_id < 0 || !node->children.size())
+            return false;
+        node = node->children[child_id];
+    }
+}
+
+template <>
+inline bool DRAM<DDR4>::check_row_open(DDR4::Command cmd, const int* addr)
+{
+    DRAM<DDR4>* node = this;
+    while (true) {
+        int child_id = addr[int(node->level)+1];
+        if (node->level == DDR4::Level::Bank && (cmd == DDR4::Command::RD || cmd == DDR4::Command::WR))
+            return DDR4::rowopen_bank(node, cmd, child_id);
+
+        if (child_id < 0 || !node->children.size())
+            return false;
+        node = node->children[child_id];
+    }
+}
+
+template <>
+inline void DRAM<DDR4>::update_state(DDR4::Command cmd, const int* addr, ulong sectors)
+{
+    DRAM<DDR4>* node = this;
+    while (true) {
+        int child_id = addr[int(node->level)+1];
+        if (node->level == DDR4::Level::Rank)
+            DDR4::lambda_rank(node, cmd, child_id, sectors);
+        else if (node->level == DDR4::Level::Bank)
+            DDR4::lambda_bank(node, cmd, child_id, sectors);
+
+        if (node->level == spec->scope[int(cmd)] || !node->children.size())
+            return; // stop: updated all levels
+        node = node->children[child_id];
+    }
+}
+
 } /*namespace ramulator*/
 
 #endif /*__DDR4_H*/
@@ -99,8 +99,30 @@ private:
 
     // Timing
     long cur_clk = 0;
-    long next[int(T::Command::MAX)]; // the earliest time in the future when a command could be ready
-    deque<long> prev[int(T::Command::MAX)]; // the most recent history of when commands were issued
+
+    // The timing state of all nodes of a level is stored in flat arrays, indexed by
+    // the position of the node within its level and owned by the channel. check(),
+    // get_next() and update_timing() index these arrays instead of chasing children.
+    struct LevelTiming
+    {
+        int fanout = 0; // children per node of the level above, 0 if the level is not instantiated
+        vector<typename T::TimingEntry>* timing = nullptr;
+        vector<DRAM<T>*> nodes;
+        vector<long> next; // [node][cmd] the earliest time in the future when a command could be ready
+        // the most recent history of when commands were issued, kept in a ring buffer
+        // per node and command: [node][hist_offset[cmd] + (hist_head[node][cmd] + i) % hist_len[cmd]]
+        int hist_size = 0;
+        int hist_offset[int(T::Command::MAX)];
+        int hist_len[int(T::Command::MAX)];
+        vector<long> hist;
+        vector<int> hist_head;
+    };
+    vector<LevelTiming> timing_owned; // only allocated by the channel
+    LevelTiming* levels = nullptr; // indexed by level
+    int index = 0; // position of this node within its level
+    long* next = nullptr; // this node's row in levels[level].next
+
+    void init_timing_state();
 
     // Lookup table for which commands must be preceded by which other commands (i.e., "prerequisite")
     // E.g., a read command to a closed bank must be preceded by an activate command
@@ -205,24 +227,10 @@ DRAM<T>::DRAM(T* spec, typename T::Level level) :
     lambda = spec->lambda[int(level)];
     timing = spec->timing[int(level)];
 
-    fill_n(next, int(T::Command::MAX), -1); // initialize future
-    for (int cmd = 0; cmd < int(T::Command::MAX); cmd++) {
-        int dist = 0;
-        for (auto& t : timing[cmd])
-            dist = max(dist, t.dist);
-
-        if (dist)
-            prev[cmd].resize(dist, -1); // initialize history
-    }
-
     // try to recursively construct my children
     int child_level = int(level) + 1;
-    if (child_level == int(T::Level::Row))
-        return; // stop recursion: rows are not instantiated as nodes
-
-    int child_max = spec->org_entry.count[child_level];
-    if (!child_max)
-        return; // stop recursion: the number of children is unspecified
+    // rows are not instantiated as nodes, neither are levels whose number of children is unspecified
+    int child_max = child_level == int(T::Level::Row) ? 0 : spec->org_entry.count[child_level];
 
     // recursively construct my children
     for (int i = 0; i < child_max; i++) {
@@ -232,6 +240,44 @@ DRAM<T>::DRAM(T* spec, typename T::Level level) :
         children.push_back(child);
     }
 
+    if (level == typename T::Level(0))
+        init_timing_state();
+}
+
+// Lay out the timing state of the tree below me level by level
+template <typename T>
+void DRAM<T>::init_timing_state()
+{
+    timing_owned.assign(int(T::Level::MAX), LevelTiming());
+    vector<DRAM<T>*> nodes = {this};
+    for (int l = int(level); nodes.size(); l++) {
+        LevelTiming& lt = timing_owned[l];
+        lt.fanout = l == int(level) ? 1 : nodes.size() / timing_owned[l - 1].nodes.size();
+        lt.timing = nodes[0]->timing;
+        lt.nodes = nodes;
+
+        for (int cmd = 0; cmd < int(T::Command::MAX); cmd++) {
+            int dist = 0;
+            for (auto& t : lt.timing[cmd])
+                dist = max(dist, t.dist);
+            lt.hist_offset[cmd] = lt.hist_size;
+            lt.hist_len[cmd] = dist;
+            lt.hist_size += dist;
+        }
+
+        lt.next.assign(nodes.size() * int(T::Command::MAX), -1); // initialize future
+        lt.hist.assign(nodes.size() * lt.hist_size, -1); // initialize history
+        lt.hist_head.assign(nodes.size() * int(T::Command::MAX), 0);
+
+        vector<DRAM<T>*> children_nodes;
+        for (int i = 0; i < int(nodes.size()); i++) {
+            nodes[i]->levels = timing_owned.data();
+            nodes[i]->index = i;
+            nodes[i]->next = &lt.next[i * int(T::Command::MAX)];
+            children_nodes.insert(children_nodes.end(), nodes[i]->children.begin(), nodes[i]->children.end());
+        }
+        nodes.swap(children_nodes);
+    }
 }
 
 template <typename T>
@@ -248,6 +294,11 @@ void DRAM<T>::insert(DRAM<T>* child)
     child->parent = this;
     child->id = children.size();
     children.push_back(child);
+
+    DRAM<T>* root = this;
+    while (root->parent)
+        root = root->parent;
+    root->init_timing_state();
 }
 
 // Decode
@@ -273,15 +324,18 @@ typename T::Command DRAM<T>::decode(typename T::Command cmd, const int* addr, ul
 template <typename T>
 bool DRAM<T>::check(typename T::Command cmd, const int* addr, long clk)
 {
-    if (next[int(cmd)] != -1 && clk < next[int(cmd)])
-        return false; // stop recursion: the check failed at this level
+    int c = int(cmd), scope = int(spec->scope[c]);
+    for (int l = int(level), i = index; ; l++) {
+        long next_clk = levels[l].next[i * int(T::Command::MAX) + c];
+        if (next_clk != -1 && clk < next_clk)
+            return false; // the check failed at this level
 
-    int child_id = addr[int(level)+1];
-    if (child_id < 0 || level == spec->scope[int(cmd)] || !children.size())
-        return true; // stop recursion: the check passed at all levels
+        int child_id = addr[l + 1];
+        if (child_id < 0 || l == scope || !levels[l + 1].fanout)
+            return true; // the check passed at all levels
 
-    // recursively check my child
-    return children[child_id]->check(cmd, addr, clk);
+        i = i * levels[l + 1].fanout + child_id;
+    }
 }
 
 // SAUGATA: added function to check whether a command is a row hit
@@ -336,11 +390,11 @@ bool DRAM<T>::check_row_open(typename T::Command cmd, const int* addr)
 template <typename T>
 long DRAM<T>::get_next(typename T::Command cmd, const int* addr)
 {
-    long next_clk = max(cur_clk, next[int(cmd)]);
-    auto node = this;
-    for (int l = int(level); l < int(spec->scope[int(cmd)]) && node->children.size() && addr[l + 1] >= 0; l++){
-        node = node->children[addr[l + 1]];
-        next_clk = max(next_clk, node->next[int(cmd)]);
+    int c = int(cmd);
+    long next_clk = max(cur_clk, next[c]);
+    for (int l = int(level), i = index; l < int(spec->scope[c]) && levels[l + 1].fanout && addr[l + 1] >= 0; l++) {
+        i = i * levels[l + 1].fanout + addr[l + 1];
+        next_clk = max(next_clk, levels[l + 1].next[i * int(T::Command::MAX) + c]);
     }
     return next_clk;
 }
@@ -375,58 +429,75 @@ void DRAM<T>::update_state(typename T::Command cmd, const int* addr, ulong secto
 template <typename T>
 void DRAM<T>::update_timing(typename T::Command cmd, const int* addr, long clk)
 {
-    // I am not a target node: I am merely one of its siblings
-    if (id != addr[int(level)]) {
-        for (auto& t : timing[int(cmd)]) {
-            if (!t.sibling)
-                continue; // not an applicable timing parameter
-
-            assert (t.dist == 1);
-
-            long future = clk + t.val;
-            next[int(t.cmd)] = max(next[int(t.cmd)], future); // update future
+    const int CMDS = int(T::Command::MAX);
+    int c = int(cmd);
+
+    // the target node and all of its children are updated at each level, starting from me
+    int first = index, count = 1;
+    for (int l = int(level); ; l++) {
+        LevelTiming& lt = levels[l];
+        int target = -1;
+
+        for (int i = first; i < first + count; i++) {
+            long* next_clk = &lt.next[i * CMDS];
+
+            // I am not a target node: I am merely one of its siblings
+            if ((l == int(level) ? id : i - first) != addr[l]) {
+                for (auto& t : lt.timing[c]) {
+                    if (!t.sibling)
+                        continue; // not an applicable timing parameter
+
+                    assert (t.dist == 1);
+
+                    long future = clk + t.val;
+                    next_clk[int(t.cmd)] = max(next_clk[int(t.cmd)], future); // update future
+                }
+                continue;
+            }
+
+            // I am a target node
+            target = i;
+            long* hist = &lt.hist[i * lt.hist_size + lt.hist_offset[c]];
+            int len = lt.hist_len[c];
+            int& head = lt.hist_head[i * CMDS + c];
+            if (len) {
+                head = (head + len - 1) % len; // drop the oldest entry
+                hist[head] = clk; // update history
+            }
+
+            for (auto& t : lt.timing[c]) {
+                if (t.sibling)
+                    continue; // not an applicable timing parameter
+
+                long past = hist[(head + t.dist - 1) % len];
+                if (past < 0)
+                    continue; // not enough history
+
+                long future = past + t.val;
+                next_clk[int(t.cmd)] = max(next_clk[int(t.cmd)], future); // update future
+                // TIANSHI: for refresh statistics
+                if (spec->is_refreshing(cmd) && spec->is_opening(t.cmd)) {
+                  DRAM<T>* node = lt.nodes[i];
+                  assert(past == clk);
+                  node->begin_of_refreshing = clk;
+                  node->end_of_refreshing = max(node->end_of_refreshing, next_clk[int(t.cmd)]);
+                  node->refresh_cycles += node->end_of_refreshing - clk;
+                  if (node->cur_serving_requests > 0) {
+                    node->refresh_intervals.push_back(make_pair(node->begin_of_refreshing, node->end_of_refreshing));
+                  }
+                }
+            }
         }
 
-        return; // stop recursion: only target nodes should be recursed
-    }
+        // Some commands have timings that are higher that their scope levels, thus
+        // we do not stop at the cmd's scope level
+        if (target < 0 || !levels[l + 1].fanout)
+            return; // updated all levels
 
-    // I am a target node
-    if (prev[int(cmd)].size()) {
-        prev[int(cmd)].pop_back();  // FIXME TIANSHI why pop back?
-        prev[int(cmd)].push_front(clk); // update history
+        // update *all* of the target's children
+        count = levels[l + 1].fanout;
+        first = target * count;
     }
-
-    for (auto& t : timing[int(cmd)]) {
-        if (t.sibling)
-            continue; // not an applicable timing parameter
-
-        long past = prev[int(cmd)][t.dist-1];
-        if (past < 0)
-            continue; // not enough history
-
-        long future = past + t.val;
-        next[int(t.cmd)] = max(next[int(t.cmd)], future); // update future
-        // TIANSHI: for refresh statistics
-        if (spec->is_refreshing(cmd) && spec->is_opening(t.cmd)) {
-          assert(past == clk);
-          begin_of_refreshing = clk;
-          end_of_refreshing = max(end_of_refreshing, next[int(t.cmd)]);
-          refresh_cycles += end_of_refreshing - clk;
-          if (cur_serving_requests > 0) {
-            refresh_intervals.push_back(make_pair(begin_of_refreshing, end_of_refreshing));
-          }
-        }
-    }
-
-    // Some commands have timings that are higher that their scope levels, thus
-    // we do not stop at the cmd's scope level
-    if (!children.size())
-        return; // stop recursion: updated all levels
-
-    // recursively update *all* of my children
-    for (auto child : children)
-        child->update_timing(cmd, addr, clk);
-
 }
 
 template <typename T>
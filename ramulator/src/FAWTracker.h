@@ -0,0 +1,79 @@
+#ifndef __FAW_TRACKER_H
+#define __FAW_TRACKER_H
+
+#include <cassert>
+#include <deque>
+
+namespace ramulator
+{
+
+/*
+  The four-activation window (tFAW) of a rank, weighted by the activated
+  sectors: the ACTs issued in the last window cycles may activate at most
+  budget sectors, i.e., four full rows. A baseline ACT takes the budget of
+  a full row. The window is evaluated at the clk of each query, so that the
+  controller does not have to tick the tracker in idle cycles.
+*/
+class FAWTracker
+{
+public:
+    FAWTracker(long window, int budget) : window(window), budget(budget) {}
+
+    // the sectors activated in the window that ends at clk
+    int used(long clk)
+    {
+        expire(clk);
+        return active;
+    }
+
+    bool fits(long clk, int sectors)
+    {
+        return used(clk) + sectors <= budget;
+    }
+
+    // The earliest cycle (at least clk) at which an ACT of this many sectors
+    // fits in the window, unless another ACT is issued before
+    long get_next(long clk, int sectors)
+    {
+        assert(sectors <= budget);
+        int free = budget - used(clk);
+        for (auto& act : acts) {
+            if (sectors <= free)
+                break;
+            free += act.sectors;
+            clk = act.clk + window;
+        }
+        return clk;
+    }
+
+    void activate(long clk, int sectors)
+    {
+        expire(clk);
+        acts.push_back({clk, sectors});
+        active += sectors;
+    }
+
+    long window;
+    int budget;
+
+private:
+    struct Act {
+        long clk;
+        int sectors;
+    };
+
+    std::deque<Act> acts;
+    int active = 0; // sum of the sectors of acts
+
+    void expire(long clk)
+    {
+        while (acts.size() && clk - acts.front().clk >= window) {
+            active -= acts.front().sectors;
+            acts.pop_front();
+        }
+    }
+};
+
+} /* namespace ramulator */
+
+#endif /* __FAW_TRACKER_H */
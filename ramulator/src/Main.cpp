@@ -1,4 +1,5 @@
 #include "Processor.h"
+#include "Checkpoint.h"
 #include "Config.h"
 #include "Controller.h"
 #include "SpeedyController.h"
@@ -50,6 +51,9 @@ void run_dramtrace(const Config& configs, Memory<T, Controller>& memory, const c
 
     Request req(addr, type, read_complete);
 
+    // stats snapshots every stats_epoch memory cycles
+    long stats_epoch = configs.get_stats_epoch();
+
     while (!end || memory.pending_requests()){
         if (!end && !stall){
             end = !trace.get_dramtrace_request(addr, type);
@@ -72,9 +76,15 @@ void run_dramtrace(const Config& configs, Memory<T, Controller>& memory, const c
         memory.tick();
         clks ++;
         Stats::curTick++; // memory clock, global, for Statistics
+
+        if (stats_epoch && clks % stats_epoch == 0)
+            Stats::statlist.snapshot(clks);
     }
     // This a workaround for statistics set only initially lost in the end
     memory.finish();
+    // unless the last epoch ended at this cycle
+    if (Stats::statlist.last_snapshot() != Stats::Tick(clks))
+        Stats::statlist.snapshot(clks);
     Stats::statlist.printall();
 
 }
@@ -91,7 +101,24 @@ void run_cputrace(const Config& configs, Memory<T, Controller>& memory, const st
     memory.ctrls[0]->setProc(&proc);
 
     long warmup_insts = configs.get_warmup_insts();
-    bool is_warming_up = (warmup_insts != 0);
+    // The warmed-up state can be saved once and restored by later runs instead of warming up again
+    string save_checkpoint = configs["save_checkpoint"];
+    string restore_checkpoint = configs["restore_checkpoint"];
+    bool is_warming_up = (warmup_insts != 0) && restore_checkpoint.empty();
+
+    // Fast-forward over cycles in which neither the processor nor the memory would change state
+    bool clock_skipping = configs.is_clock_skipping();
+
+    // Stats snapshots every stats_epoch CPU cycles, or memory cycles with stats_epoch_clock = memory
+    long stats_epoch = configs.get_stats_epoch();
+    int epoch_unit = configs["stats_epoch_clock"] == "memory" ? cpu_tick : mem_tick; // iterations per cycle
+
+    if (is_warming_up && configs.is_functional_warmup()) {
+        if (!proc.functional_warmup(warmup_insts))
+            printf("WARNING: The end of the input trace file was reached during warmup. "
+                    "Consider changing warmup_insts in the config file. \n");
+        is_warming_up = false;
+    }
 
     for(long i = 0; is_warming_up; i++){
         proc.tick();
@@ -112,6 +139,45 @@ void run_cputrace(const Config& configs, Memory<T, Controller>& memory, const st
             break;
         }
 
+        if (clock_skipping) {
+            long proc_idle = proc.idle_cycles();
+            if (proc_idle > 0) {
+                // the memory is ticked mem_tick times at the end of every cpu_tick cycles
+                long mem_idle = memory.idle_cycles();
+                long next_burst = ((i + 1) / cpu_tick + 1) * cpu_tick - 1;
+                long mem_wake = next_burst + (mem_idle / mem_tick) * cpu_tick;
+                long target = min(i + proc_idle, mem_wake - 1);
+
+                proc.skip(target - i);
+                Stats::curTick += target - i;
+                memory.skip(mem_tick * ((target + 1) / cpu_tick - (i + 1) / cpu_tick));
+                i = target;
+            }
+        }
+    }
+
+    if (!save_checkpoint.empty()) {
+        // complete the requests in flight, a checkpoint holds no requests
+        proc.drain();
+        for (long i = 0; !proc.is_drained() || memory.pending_requests() != 0; i++) {
+            proc.tick();
+            Stats::curTick++;
+            if (i % cpu_tick == (cpu_tick - 1))
+                for (int j = 0; j < mem_tick; j++)
+                    memory.tick();
+        }
+        Checkpoint ckpt(save_checkpoint, Checkpoint::Mode::Save);
+        proc.checkpoint(ckpt);
+        memory.checkpoint(ckpt);
+        printf("Saved the warmed-up state to %s\n", save_checkpoint.c_str());
+        return;
+    }
+
+    if (!restore_checkpoint.empty()) {
+        Checkpoint ckpt(restore_checkpoint, Checkpoint::Mode::Restore);
+        proc.checkpoint(ckpt);
+        memory.checkpoint(ckpt);
+        printf("Restored the warmed-up state from %s\n", restore_checkpoint.c_str());
     }
 
     warmup_complete = true;
@@ -123,7 +189,8 @@ void run_cputrace(const Config& configs, Memory<T, Controller>& memory, const st
     printf("Starting the simulation...\n");
 
     int tick_mult = cpu_tick * mem_tick;
-    for (long i = 0; ; i++) {
+    long i = 0;
+    for (; ; i++) {
         if (((i % tick_mult) % mem_tick) == 0) { // When the CPU is ticked cpu_tick times,
                                                  // the memory controller should be ticked mem_tick times
             proc.tick();
@@ -154,9 +221,35 @@ void run_cputrace(const Config& configs, Memory<T, Controller>& memory, const st
         if (((i % tick_mult) % cpu_tick) == 0) // TODO_hasan: Better if the processor ticks the memory controller
             memory.tick();
 
+        if (stats_epoch && i % epoch_unit == 0 && (i / epoch_unit + 1) % stats_epoch == 0)
+            Stats::statlist.snapshot(i / epoch_unit + 1);
+
+        if (clock_skipping && ((i % tick_mult) % mem_tick) == 0) {
+            long proc_idle = proc.idle_cycles();
+            if (proc_idle > 0) {
+                long mem_idle = memory.idle_cycles();
+                long proc_wake = (i / mem_tick + proc_idle + 1) * mem_tick;
+                long mem_wake = (i / cpu_tick + mem_idle + 1) * cpu_tick;
+                long target = min(proc_wake, mem_wake) - 1;
+                if (stats_epoch) {
+                    // do not skip the cycle of the next snapshot
+                    long next_snapshot = ((i / epoch_unit + 1) / stats_epoch + 1) * stats_epoch;
+                    target = min(target, (next_snapshot - 1) * epoch_unit - 1);
+                }
+
+                proc.skip(target / mem_tick - i / mem_tick);
+                Stats::curTick += target / mem_tick - i / mem_tick;
+                memory.skip(target / cpu_tick - i / cpu_tick);
+                i = target;
+            }
+        }
+
     }
     // This a workaround for statistics set only initially lost in the end
     memory.finish();
+    // unless the last epoch ended at this cycle
+    if (Stats::statlist.last_snapshot() != Stats::Tick(i / epoch_unit + 1))
+        Stats::statlist.snapshot(i / epoch_unit + 1);
     Stats::statlist.printall();
 }
 
@@ -239,6 +332,9 @@ int main(int argc, const char *argv[])
     std::vector<const char*> files(&argv[trace_start], &argv[argc]);
     configs.set_core_num(argc - trace_start);
 
+    if (configs.get_stats_epoch() > 0)
+      Stats::statlist.snapshot_output(stats_out + ".epochs", configs.is_stats_epoch_delta());
+
    if (standard == "DDR4") {
       DDR4* ddr4 = new DDR4(configs);
       start_run(configs, ddr4, files);
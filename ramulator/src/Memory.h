@@ -18,6 +18,8 @@
 #include <cmath>
 #include <cassert>
 #include <tuple>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
@@ -41,6 +43,8 @@ public:
     virtual void record_core(int coreid) = 0;
     virtual void set_high_writeq_watermark(const float watermark) = 0;
     virtual void set_low_writeq_watermark(const float watermark) = 0;
+    // Page translation and controller state, no request may be pending
+    virtual void checkpoint(Checkpoint& ckpt) = 0;
 };
 
 template <class T, template<typename> class Controller = Controller >
@@ -109,11 +113,23 @@ public:
 
     int tx_bits;
 
+    // With channel_threads > 1, tick() spreads the channels over worker threads
+    // (the simulation thread takes channels 0, channel_threads, ...) and waits
+    // for all of them at the end of every memory cycle
+    vector<std::thread> workers;
+    vector<char> channel_can_schedule;
+    std::atomic<long> tick_epoch{0}; // memory cycles started
+    std::atomic<int> workers_done{0}; // workers that finished the current cycle
+    std::atomic<bool> stop_workers{false};
+    static const int SPINS_BEFORE_YIELD = 1000;
+
     Memory(const Config& configs, vector<Controller<T>*> ctrls)
         : ctrls(ctrls),
           spec(ctrls[0]->channel->spec),
           addr_bits(int(T::Level::MAX))
     {
+        static_assert(int(T::Level::MAX) <= AddrVec::MAX_LEVELS, "too many levels for a request address");
+
         // make sure 2^N channels/ranks
         // TODO support channel number that is not powers of 2
         int *sz = spec->org_entry.count;
@@ -266,10 +282,26 @@ public:
         sectoredDRAM = configs.is_sectoredDRAM();
         sector_size = configs.get_sector_size();
 
+        int channel_threads = min(configs.get_channel_threads(), int(ctrls.size()));
+        int hw_threads = std::thread::hardware_concurrency();
+        if (hw_threads && channel_threads > hw_threads) {
+            printf("Only %d hardware threads, limiting channel_threads to %d\n", hw_threads, hw_threads);
+            channel_threads = hw_threads;
+        }
+        if (channel_threads > 1) {
+            channel_can_schedule.resize(ctrls.size());
+            for (auto ctrl : ctrls)
+                ctrl->defer_callbacks = true;
+            for (int t = 1; t < channel_threads; t++)
+                workers.emplace_back(&Memory::channel_worker, this, t);
+        }
     }
 
     ~Memory()
     {
+        stop_workers = true;
+        for (auto& worker : workers)
+            worker.join();
         for (auto ctrl: ctrls)
             delete ctrl;
         delete spec;
@@ -314,14 +346,100 @@ public:
           // only if another command was not scheduled (approximately)
           bool can_schedule = !DGMS || ((long) num_dram_cycles.value() % 8 == i);
           is_active = is_active || ctrl->is_active();
-          ctrl->tick(can_schedule);
+          if (workers.size())
+            channel_can_schedule[i] = can_schedule;
+          else
+            ctrl->tick(can_schedule);
           i++;
         }
+        if (workers.size())
+          tick_parallel();
         if (is_active) {
           ramulator_active_cycles++;
         }
     }
 
+    void tick_channels(int thread)
+    {
+        for (unsigned int i = thread; i < ctrls.size(); i += workers.size() + 1)
+          ctrls[i]->tick(channel_can_schedule[i]);
+    }
+
+    void tick_parallel()
+    {
+        workers_done.store(0, std::memory_order_relaxed);
+        tick_epoch.fetch_add(1, std::memory_order_release);
+        tick_channels(0);
+
+        int spins = 0;
+        while (workers_done.load(std::memory_order_acquire) != int(workers.size()))
+          if (++spins > SPINS_BEFORE_YIELD)
+            std::this_thread::yield();
+
+        // callbacks reach the caches and cores, so they run here in channel order
+        for (auto ctrl : ctrls)
+          ctrl->run_deferred();
+    }
+
+    void channel_worker(int thread)
+    {
+        long epoch = 0;
+        while (true) {
+          int spins = 0;
+          while (tick_epoch.load(std::memory_order_acquire) == epoch) {
+            if (stop_workers)
+              return;
+            if (++spins > SPINS_BEFORE_YIELD)
+              std::this_thread::yield();
+          }
+          epoch++;
+          tick_channels(thread);
+          workers_done.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    // Number of upcoming memory cycles in which no controller changes state
+    long idle_cycles()
+    {
+        long next = ctrls[0]->next_event();
+        for (unsigned int i = 1; i < ctrls.size(); i++)
+            next = min(next, ctrls[i]->next_event());
+        return next - ctrls[0]->clk - 1;
+    }
+
+    // Skip idle memory cycles, crediting the statistics tick() accumulates every cycle
+    void skip(long cycles)
+    {
+        long cur_cycles = num_dram_cycles.value();
+        num_dram_cycles += cycles;
+        int cur_que_req_num = 0;
+        int cur_que_readreq_num = 0;
+        int cur_que_writereq_num = 0;
+        bool is_active = false;
+        for (auto ctrl : ctrls) {
+          cur_que_req_num += ctrl->readq.size() + ctrl->writeq.size() + ctrl->pending.size();
+          cur_que_readreq_num += ctrl->readq.size() + ctrl->pending.size();
+          cur_que_writereq_num += ctrl->writeq.size();
+          is_active = is_active || ctrl->is_active();
+        }
+        in_queue_req_num_sum += cycles * cur_que_req_num;
+        in_queue_read_req_num_sum += cycles * cur_que_readreq_num;
+        in_queue_write_req_num_sum += cycles * cur_que_writereq_num;
+        if (is_active) {
+          ramulator_active_cycles += cycles;
+        }
+
+        int i = 0;
+        for (auto ctrl : ctrls) {
+          long sched_cycles = cycles;
+          // For DGMS, count the cycles in which this channel could schedule (see tick())
+          if (DGMS)
+            sched_cycles = count_cycles_mod8(cur_cycles + cycles, i) - count_cycles_mod8(cur_cycles, i);
+          ctrl->skip(cycles, sched_cycles);
+          i++;
+        }
+    }
+
     bool send(Request req)
     {
         req.addr_vec.resize(addr_bits.size());
@@ -524,9 +642,9 @@ public:
         }
     }
     
-    void apply_mapping(long addr, std::vector<int>& addr_vec){
+    void apply_mapping(long addr, AddrVec& addr_vec){
         int *sz = spec->org_entry.count;
-        int addr_total_bits = sizeof(addr_vec)*8;
+        int addr_total_bits = sizeof(addr)*8;
         int addr_bits [int(T::Level::MAX)];
         for (int i = 0 ; i < int(T::Level::MAX) ; i ++)
         {
@@ -592,6 +710,19 @@ public:
       in_queue_write_req_num_avg = in_queue_write_req_num_sum.value() / dram_cycles;
     }
 
+    void checkpoint(Checkpoint& ckpt) {
+        assert(!ckpt.saving() || pending_requests() == 0);
+
+        ckpt.check(int(translation), "page translation");
+        ckpt.io(page_translation);
+        ckpt.io(free_physical_pages);
+        ckpt.io(free_physical_pages_remaining);
+
+        ckpt.check(ctrls.size(), "number of channels");
+        for (auto ctrl : ctrls)
+            ctrl->checkpoint(ckpt);
+    }
+
     long page_allocator(long addr, int coreid) {
         long virtual_page_number = addr >> 12;
 
@@ -647,6 +778,12 @@ public:
 
 private:
 
+    // Number of cycles in [0, cycles] whose index modulo 8 is i
+    long count_cycles_mod8(long cycles, int i)
+    {
+        return cycles < i ? 0 : (cycles - i) / 8 + 1;
+    }
+
     int calc_log2(int val){
         int n = 0;
         while ((val >>= 1))
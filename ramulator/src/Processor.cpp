@@ -1,5 +1,9 @@
 #include "Processor.h"
 #include <cassert>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace ramulator;
@@ -111,6 +115,34 @@ void Processor::tick() {
   }
 }
 
+long Processor::idle_cycles() {
+  for (auto& core : cores)
+    if (!core->is_idle())
+      return 0;
+
+  // keep the heartbeat printed
+  long cycles = long(cpu_cycles.value());
+  long idle = (cycles / 50000000 + 1) * 50000000 - cycles - 1;
+
+  if (!(no_core_caches && no_shared_cache)) {
+    long next = cachesys->next_event();
+    if (next != -1)
+      idle = min(idle, next - cachesys->clk - 1);
+  }
+
+  return idle;
+}
+
+void Processor::skip(long cycles) {
+  cpu_cycles += cycles;
+
+  if (!(no_core_caches && no_shared_cache)) {
+    cachesys->clk += cycles;
+  }
+  for (auto& core : cores)
+    core->clk += cycles;
+}
+
 void Processor::receive(Request& req) {
   //printf("[Processor] Actually received a read response: IA:0x%lx A:0x%lx SB:%lx\n", req.inst_addr, req.addr, req.sector_bits[0]);
 
@@ -227,6 +259,53 @@ long Processor::get_insts() {
     return insts_total;
 }
 
+void Processor::drain() {
+    for (auto& core : cores)
+        core->draining = true;
+}
+
+bool Processor::is_drained() {
+    for (auto& core : cores)
+        if (!core->is_drained())
+            return false;
+
+    if (!no_shared_cache && !llc.is_drained())
+        return false;
+
+    return cachesys->is_empty();
+}
+
+void Processor::checkpoint(Checkpoint& ckpt) {
+    ckpt.check(cores.size(), "number of cores");
+    for (auto& core : cores)
+        core->checkpoint(ckpt);
+
+    ckpt.check(!no_shared_cache, "shared cache");
+    if (!no_shared_cache)
+        llc.checkpoint(ckpt);
+}
+
+bool Processor::functional_warmup(long warmup_insts) {
+    // the caches serve every request at once (see Cache::warm)
+    cachesys->functional = true;
+
+    bool warming_up = true;
+    while (warming_up) {
+        warming_up = false;
+        for (auto& core : cores) {
+            if (core->get_insts() >= warmup_insts || core->finished() || core->has_reached_limit()) continue;
+            warming_up = true;
+            core->warm();
+        }
+
+        if (warming_up && has_reached_limit())
+            break;
+    }
+
+    cachesys->functional = false;
+    return !warming_up;
+}
+
 void Processor::reset_stats() {
     for (unsigned int i = 0 ; i < cores.size(); i++) {
         cores[i]->reset_stats();
@@ -243,7 +322,9 @@ Core::Core(const Config& configs, int coreid,
     Cache* llc, std::shared_ptr<CacheSystem> cachesys, MemoryBase& memory)
     : id(coreid), no_core_caches(!configs.has_core_caches()),
     no_shared_cache(!configs.has_l3_cache()),
-    llc(llc), trace(trace_fname), memory(memory)
+    llc(llc),
+    window(configs.get_window_ipc(), configs.get_window_depth(), ~(long(l1_blocksz) - 1)),
+    trace(trace_fname), memory(memory)
 {
 
   cout << "[Core] Sector Size: " << sector_size << endl;
@@ -359,6 +440,57 @@ void Core::dump_window()
   window.dump();
 }
 
+bool Core::is_idle()
+{
+    if (window.can_retire())
+        return false;
+
+    if (first_level_cache != nullptr && first_level_cache->has_retries())
+        return false;
+
+    if (draining) return true;
+
+    if (expected_limit_insts == 0 && !more_reqs) return true;
+
+    if (expected_limit_insts == long(cpu_inst.value()) && reached_limit) return true;
+
+    // the window stays full until a pending read is served
+    return window.is_full() && (bubble_cnt > 0 || req_type == Request::Type::READ);
+}
+
+bool Core::is_drained()
+{
+    if (!window.is_empty())
+        return false;
+
+    for (auto& cache : caches)
+        if (!cache->is_drained())
+            return false;
+
+    return true;
+}
+
+void Core::checkpoint(Checkpoint& ckpt)
+{
+    assert(!ckpt.saving() || window.is_empty());
+    trace.checkpoint(ckpt);
+
+    // the next request, already read from the trace
+    ckpt.io(bubble_cnt);
+    ckpt.io(req_addr);
+    ckpt.io(req_type);
+    ckpt.io(sector_bits);
+    ckpt.io(req_size);
+    ckpt.io(req_inst_addr);
+    ckpt.io(req_actual_access);
+    ckpt.io(more_reqs);
+    ckpt.io(dynamicOn);
+
+    ckpt.check(caches.size(), "number of core caches");
+    for (auto& cache : caches)
+        cache->checkpoint(ckpt);
+}
+
 void Core::tick()
 {
     clk++;
@@ -368,6 +500,8 @@ void Core::tick()
 
     retired += window.retire();
 
+    if (draining) return;
+
     if (expected_limit_insts == 0 && !more_reqs) return;
 
     // TODO, stop cores that have already finished executing
@@ -398,13 +532,7 @@ void Core::tick()
         if (inserted == window.ipc) return;
         if (window.is_full()) return;
 
-        Request req(req_addr, req_type, callback, id);
-        req.sector_bits[0] = sector_bits;
-        req.sector_bits[1] = sector_bits;
-        req.sector_bits[2] = sector_bits;
-        req.size = req_size;
-        req.inst_addr = req_inst_addr;
-        req.actual_access = req_actual_access;
+        Request req = make_request();
         if (!send(req)) return;
         //printf("[Processor] Actually sent a read request: IA:0x%lx A:0x%lx SB:%lx\n", req.inst_addr, req.addr, req.sector_bits[0]);
         window.insert(false, req_addr, sector_bits);
@@ -413,13 +541,7 @@ void Core::tick()
     else {
         // write request
         assert(req_type == Request::Type::WRITE);
-        Request req(req_addr, req_type, callback, id);
-        req.sector_bits[0] = sector_bits;
-        req.sector_bits[1] = sector_bits;
-        req.sector_bits[2] = sector_bits;
-        req.size = req_size;
-        req.inst_addr = req_inst_addr;
-        req.actual_access = req_actual_access;
+        Request req = make_request();
         if (!send(req)) return;
         cpu_inst++;
     }
@@ -430,6 +552,48 @@ void Core::tick()
       reached_limit = true;
     }
 
+    read_next_request();
+}
+
+void Core::warm()
+{
+    if (expected_limit_insts == 0 && !more_reqs) return;
+
+    // non-memory instructions do not change the caches
+    cpu_inst += bubble_cnt;
+    bubble_cnt = 0;
+
+    // without caches, the request is dropped, its page has already been
+    // allocated when it was read from the trace
+    if (first_level_cache != nullptr || llc != nullptr) {
+        bool sent = send(make_request());
+        assert(sent && "The caches serve every request during the functional warmup");
+    }
+    cpu_inst++;
+    if (expected_limit_insts > 0 && long(cpu_inst.value()) >= expected_limit_insts && !reached_limit) {
+      record_cycs = clk;
+      record_insts = long(cpu_inst.value());
+      memory.record_core(id);
+      reached_limit = true;
+    }
+
+    read_next_request();
+}
+
+Request Core::make_request()
+{
+    Request req(req_addr, req_type, callback, id);
+    req.sector_bits[0] = sector_bits;
+    req.sector_bits[1] = sector_bits;
+    req.sector_bits[2] = sector_bits;
+    req.size = req_size;
+    req.inst_addr = req_inst_addr;
+    req.actual_access = req_actual_access;
+    return req;
+}
+
+void Core::read_next_request()
+{
     /*
     if (no_core_caches) {
       more_reqs = trace.get_filtered_request(
@@ -474,7 +638,7 @@ long Core::get_insts() {
 void Core::receive(Request& req)
 {
     // sector bits 1 because those are what brought to L1
-    window.set_ready(req.addr, ~(l1_blocksz - 1l), req.sector_bits[0]);
+    window.set_ready(req.addr, req.sector_bits[0]);
     if (req.arrive != -1 && req.depart > last) {
       memory_access_cycles += (req.depart - max(last, req.arrive));
       last = req.depart;
@@ -487,11 +651,24 @@ void Core::reset_stats() {
     cpu_inst = 0;
 }
 
+Window::Window(int ipc, int depth, long line_mask)
+    : ipc(ipc), depth(depth), ready_list(depth), addr_list(depth, -1),
+    sector_list(depth, 0), line_mask(line_mask), next_waiter(depth, -1)
+{
+    assert(ipc > 0 && depth > 0);
+    first_waiter.reserve(depth);
+}
+
 bool Window::is_full()
 {
     return load == depth;
 }
 
+bool Window::can_retire()
+{
+    return load > 0 && ready_list[tail];
+}
+
 bool Window::is_empty()
 {
     return load == 0;
@@ -516,9 +693,15 @@ void Window::insert(bool ready, long addr, ulong sectors = 0UL)
 {
     assert(load <= depth);
 
-    ready_list.at(head) = ready;
-    addr_list.at(head) = addr;
-    sector_list.at(head) = sectors;
+    ready_list[head] = ready;
+    addr_list[head] = addr;
+    sector_list[head] = sectors;
+
+    if (!ready) {
+        auto waiter = first_waiter.emplace(addr & line_mask, head);
+        next_waiter[head] = waiter.second ? -1 : waiter.first->second;
+        waiter.first->second = head;
+    }
 
     head = (head + 1) % depth;
     load++;
@@ -533,7 +716,7 @@ long Window::retire()
 
     int retired = 0;
     while (load > 0 && retired < ipc) {
-        if (!ready_list.at(tail))
+        if (!ready_list[tail])
             break;
 
         tail = (tail + 1) % depth;
@@ -545,100 +728,172 @@ long Window::retire()
 }
 
 
-void Window::set_ready(long addr, int mask, ulong sector_bits = 0UL)
+void Window::set_ready(long addr, ulong sector_bits)
 {
-    if (load == 0) return;
+    auto waiter = first_waiter.find(addr & line_mask);
+    if (waiter == first_waiter.end()) return;
+
+    // a slot is ready once all of its sectors have arrived
+    int* link = &waiter->second;
+    while (*link != -1) {
+        int index = *link;
+        sector_list[index] &= (~sector_bits);
+        if (sector_list[index] == 0UL) {
+            ready_list[index] = true;
+            *link = next_waiter[index];
+        } else {
+            link = &next_waiter[index];
+        }
+    }
 
-    for (int i = 0; i < load; i++) {
-        int index = (tail + i) % depth;
+    if (waiter->second == -1)
+        first_waiter.erase(waiter);
+}
 
-        if ((addr_list.at(index) & mask) == (addr & mask))
-        {
-          // printf("Masking wait list addr 0x%lx sectors 0x%lx -- incoming sectors 0x%lx\n", (addr_list.at(index) & mask), sector_list.at(index), sector_bits);
-          sector_list.at(index) &= (~sector_bits);
-        }
+Trace::Trace(const char* trace_fname) : file(trace_fname), trace_name(trace_fname)
+{
+    if (!file.good()) {
+        std::cerr << "Bad trace file: " << trace_fname << std::endl;
+        exit(1);
+    }
 
-        if ((((addr_list.at(index) & mask) == (addr & mask)) && sector_list.at(index) == 0UL) || (addr_list.at(index) == -1))
-        {
-          ready_list.at(index) = true;
-        }
-                    
+    decompress_command = TraceReader::decompress_command(trace_name);
+    if (!decompress_command.empty()) {
+        file.close();
+        return;
+    }
+
+    BinaryTrace::Header header;
+    if (!file.read((char*) &header, sizeof(header)) || !BinaryTrace::is_binary(header)) {
+        // text trace
+        file.clear();
+        file.seekg(0, file.beg);
+        return;
+    }
+    file.close();
 
-        /*
-        if (
-            ( 
-              ((addr_list.at(index) & mask) == (addr & mask))
-              && (sector_list.at(index) == sector_bits)
-            )
-            || (addr_list.at(index) == -1)
-           )
-           {
-             //printf("Window::SetReady addr %ld sector_bits %ld %s\n", addr, sector_bits, addr_list.at(index) == -1 ? "BUBBLE" : "");
-             ready_list.at(index) = true;
-           }
-        // */
+    if (header.version != BinaryTrace::VERSION || header.record_size != sizeof(BinaryTrace::Record)) {
+        std::cerr << "Unsupported binary trace version " << header.version << ": " << trace_fname << std::endl;
+        exit(1);
     }
-}
 
+    int fd = open(trace_fname, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        std::cerr << "Bad trace file: " << trace_fname << std::endl;
+        exit(1);
+    }
+    mapped_size = st.st_size;
+    num_records = (mapped_size - sizeof(header)) / sizeof(BinaryTrace::Record);
+    if (num_records == 0) {
+        std::cerr << "Empty binary trace: " << trace_fname << std::endl;
+        exit(1);
+    }
+    mapped = mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Cannot map trace file: " << trace_fname << std::endl;
+        exit(1);
+    }
+    madvise(mapped, mapped_size, MADV_SEQUENTIAL);
+    records = (const BinaryTrace::Record*) ((const char*) mapped + sizeof(header));
+}
 
+Trace::~Trace()
+{
+    if (mapped)
+        munmap(mapped, mapped_size);
+}
 
-Trace::Trace(const char* trace_fname) : file(trace_fname), trace_name(trace_fname)
+void Trace::read_record(BinaryTrace::Record& rec)
 {
-    if (!file.good()) {
-        std::cerr << "Bad trace file: " << trace_fname << std::endl;
+    if (!decompress_command.empty()) {
+        if (!reader)
+            reader.reset(new TraceReader(trace_name, decompress_command));
+        reader->next(rec);
+        records_read++;
+        return;
+    }
+
+    if (records) {
+        rec = records[next_record];
+        if (++next_record == num_records)
+            next_record = 0;
+        return;
+    }
+
+    string line;
+    getline(file, line);
+    if (file.eof()) {
+        file.clear();
+        file.seekg(0, file.beg);
+        getline(file, line);
+    }
+
+    if (!BinaryTrace::parse_line(line.c_str(), rec)) {
+        std::cerr << "Bad line in trace file " << trace_name << ": " << line << std::endl;
         exit(1);
     }
 }
 
+void Trace::checkpoint(Checkpoint& ckpt)
+{
+    // position of the next record in the trace file
+    long position = 0;
+    if (ckpt.saving()) {
+        if (!decompress_command.empty())
+            position = records_read;
+        else if (records)
+            position = next_record;
+        else
+            position = file.tellg();
+    }
+    ckpt.io(position);
+
+    if (!ckpt.saving()) {
+        if (!decompress_command.empty()) {
+            reader.reset(new TraceReader(trace_name, decompress_command));
+            BinaryTrace::Record rec;
+            for (records_read = 0; records_read < position; records_read++)
+                reader->next(rec);
+        } else if (records) {
+            assert(position < num_records && "The checkpoint does not match the trace");
+            next_record = position;
+        } else {
+            file.clear();
+            file.seekg(position);
+        }
+    }
+
+    ckpt.io(pretrace_buffer);
+    if (!ckpt.saving()) {
+        // rebuild the lookahead index
+        std::deque<Entry> entries;
+        entries.swap(pretrace_buffer);
+        pretrace_sectors.clear();
+        for (auto& entry : entries)
+            push_pretrace(entry);
+    }
+    ckpt.io(dynamicOn);
+}
+
 void Trace::populate_pretrace_buffer()
 {
     int requests_to_read = pretrace_buffer_size - pretrace_buffer.size();
 
     for (int i = 0 ; i < requests_to_read ; i++)
     {
-      string line;
-      getline(file, line);
-      if (file.eof()) {
-        file.clear();
-        file.seekg(0, file.beg);
-        getline(file, line);
-        //return false;
-      }
+      BinaryTrace::Record rec;
+      read_record(rec);
 
-      string delim = " ";
-      size_t pos = 0;
-
-      std::string token;
-
-      pos = line.find(delim);
-      token = line.substr(0, pos);
-      long inst_addr = std::stoul(token, nullptr, 16);
-      line.erase(0, pos + delim.length());
-      
-      pos = line.find(delim);
-      token = line.substr(0, pos);
-      long bubble_cnt = std::stoul(token);
-      line.erase(0, pos + delim.length());
-      
-      Request::Type req_type;
-      pos = line.find(delim);
-      token = line.substr(0, pos);
-      if (token[0] == 'R')
-          req_type = Request::Type::READ;
-      else
-          req_type = Request::Type::WRITE; 
-      line.erase(0, pos + delim.length());
-
-      pos = line.find(delim);
-      token = line.substr(0, pos);
-      long req_addr = std::stoul(token, nullptr, 16);
+      long inst_addr = rec.inst_addr;
+      long bubble_cnt = rec.bubble_cnt;
+      Request::Type req_type = rec.is_write ? Request::Type::WRITE : Request::Type::READ;
+      long req_addr = rec.addr;
       //printf("RAPrev:%lx RANow:%lx\n", (req_addr & 0x3f), req_addr);
-      line.erase(0, pos + delim.length());
 
       // Memory request's size in bytes
-      int req_size;
-      // At this point only size is left in line
-      req_size = std::stoi(line);
+      int req_size = rec.size;
 
       if (req_size > 64)
       {
@@ -665,7 +920,7 @@ void Trace::populate_pretrace_buffer()
           if (!dynamicOn)
             first_sector_bits = 0xff; // retrieve all sectors
 
-          pretrace_buffer.push_back(Entry{inst_addr, bubble_cnt, req_type, (req_addr & ~0x3f), first_sector_bits, (int) (64 - (req_addr & 0x3f)), first_sector_bits});
+          push_pretrace(Entry{inst_addr, bubble_cnt, req_type, (req_addr & ~0x3f), first_sector_bits, (int) (64 - (req_addr & 0x3f)), first_sector_bits});
           //printf("Divided a two-cache-block-spanning request of size %d into two\n", req_size);
           //printf("Req1 - Addr: %lx Sector Bits: %lx\n", req_addr, first_sector_bits);
 
@@ -680,7 +935,7 @@ void Trace::populate_pretrace_buffer()
           if (!dynamicOn)
             second_sector_bits = 0xff; // retrieve all sectors
 
-          pretrace_buffer.push_back(Entry{inst_addr, 1, req_type, (req_addr & (~0x3f)) + 64, second_sector_bits, (int) (req_size - (64 - (req_addr & 0x3f))), second_sector_bits});
+          push_pretrace(Entry{inst_addr, 1, req_type, (req_addr & (~0x3f)) + 64, second_sector_bits, (int) (req_size - (64 - (req_addr & 0x3f))), second_sector_bits});
           //printf("Req2 - Addr: %lx Sector Bits: %lx\n", (req_addr & (~0x3f)) + 64, second_sector_bits);
 
           i++; // because we inject two requests
@@ -705,8 +960,8 @@ void Trace::populate_pretrace_buffer()
         if ((req_addr + req_size) > ((req_addr & ~0x3f) + 64))
         {
 
-          pretrace_buffer.push_back(Entry{inst_addr, bubble_cnt, req_type, (req_addr & ~0x3f), 0, (int) (64 - (req_addr & 0x3f)), 0});
-          pretrace_buffer.push_back(Entry{inst_addr, 1, req_type, (req_addr & (~0x3f)) + 64, 0, (int) (req_size - (64 - (req_addr & 0x3f))), 0});
+          push_pretrace(Entry{inst_addr, bubble_cnt, req_type, (req_addr & ~0x3f), 0, (int) (64 - (req_addr & 0x3f)), 0});
+          push_pretrace(Entry{inst_addr, 1, req_type, (req_addr & (~0x3f)) + 64, 0, (int) (req_size - (64 - (req_addr & 0x3f))), 0});
           i++;
           continue;
         }
@@ -715,15 +970,47 @@ void Trace::populate_pretrace_buffer()
       if (!dynamicOn)
         sector_bits = 0xff; // retrieve all sectors
       //printf("%ld %ld %d %ld %ld %d\n", inst_addr, bubble_cnt, req_type, req_addr, sector_bits, req_size);
-      pretrace_buffer.push_back(Entry{inst_addr, bubble_cnt, req_type, req_addr & ~0x3f, sector_bits, req_size, req_actual_access});      
+      push_pretrace(Entry{inst_addr, bubble_cnt, req_type, req_addr & ~0x3f, sector_bits, req_size, req_actual_access});      
+    }
+}
+
+void Trace::push_pretrace(const Entry& entry)
+{
+    pretrace_buffer.push_back(entry);
+    if (!lookahead_predictor)
+        return;
+
+    assert(!(entry.sector_bits >> MAX_SECTORS) && "Too many sectors for the lookahead predictor");
+    BlockSectors& block = pretrace_sectors[entry.req_addr & (~0x3f)];
+    block.entries++;
+    block.sector_bits |= entry.sector_bits;
+    for (ulong bits = entry.sector_bits; bits; bits &= bits - 1)
+        block.sector_count[__builtin_ctzl(bits)]++;
+}
+
+void Trace::pop_pretrace()
+{
+    const Entry& entry = pretrace_buffer.front();
+    if (lookahead_predictor) {
+        auto block = pretrace_sectors.find(entry.req_addr & (~0x3f));
+        if (--block->second.entries == 0)
+            pretrace_sectors.erase(block);
+        else {
+            for (ulong bits = entry.sector_bits; bits; bits &= bits - 1) {
+                int sector = __builtin_ctzl(bits);
+                if (--block->second.sector_count[sector] == 0)
+                    block->second.sector_bits &= ~(1UL << sector);
+            }
+        }
     }
+    pretrace_buffer.pop_front();
 }
 
 bool Trace::get_unfiltered_request(long& bubble_cnt, long& req_addr, Request::Type& req_type, ulong& sector_bits, int& req_size, long& req_inst_addr, ulong& req_actual_access)
 {
     populate_pretrace_buffer();
 
-    Entry request = pretrace_buffer.front(); pretrace_buffer.pop_front();
+    Entry request = pretrace_buffer.front(); pop_pretrace();
 
     bubble_cnt = request.bubble_cnt;
     req_inst_addr = request.req_inst_addr;
@@ -736,20 +1023,11 @@ bool Trace::get_unfiltered_request(long& bubble_cnt, long& req_addr, Request::Ty
     // TODO: insert lookahead predictor here
     if (lookahead_predictor)
     {
-        // Traverse pretrace buffer (# of lookahead size -1 entries)
-        // Find loads/stores that address the same cache block
-        long cache_block_id = req_addr & (~0x3f);
-        int coalesce_count = 0;
-        for (auto it = pretrace_buffer.cbegin(); it != pretrace_buffer.cend(); ++it) 
-        {
-            long req_cache_block_id = (*it).req_addr & (~0x3f);
-            if (req_cache_block_id == cache_block_id)
-            {
-                sector_bits |= (*it).sector_bits;
-                coalesce_count++;
-            }
-        }
-        //cout << "Lookahead predictor coalesced " << coalesce_count << " entries" << endl; 
+        // Coalesce the sectors of the loads/stores in the pretrace buffer
+        // (# of lookahead size -1 entries) that address the same cache block
+        auto block = pretrace_sectors.find(req_addr & (~0x3f));
+        if (block != pretrace_sectors.end())
+            sector_bits |= block->second.sector_bits;
     }
 
     assert(!(sectoredDRAM || DGMS) || sector_bits != 0);
@@ -819,6 +1097,7 @@ bool Trace::get_filtered_request(long& bubble_cnt, long& req_addr, Request::Type
 
 bool Trace::get_dramtrace_request(long& req_addr, Request::Type& req_type)
 {
+    assert(decompress_command.empty() && "Compressed traces are only supported in CPU trace mode");
     string line;
     getline(file, line);
     if (file.eof()) {
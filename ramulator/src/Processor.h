@@ -2,10 +2,13 @@
 #define __PROCESSOR_H
 
 #include "Cache.h"
+#include "Checkpoint.h"
 #include "Config.h"
 #include "Memory.h"
 #include "Request.h"
 #include "Statistics.h"
+#include "TraceFormat.h"
+#include "TraceReader.h"
 #include <iostream>
 #include <vector>
 #include <deque>
@@ -13,6 +16,8 @@
 #include <string>
 #include <ctype.h>
 #include <functional>
+#include <memory>
+#include <unordered_map>
 
 namespace ramulator 
 {
@@ -20,6 +25,7 @@ namespace ramulator
 class Trace {
 public:
     Trace(const char* trace_fname);
+    ~Trace();
     // trace file format 1:
     // [# of bubbles(non-mem instructions)] [read address(dec or hex)] <optional: write address(evicted cacheline)>
     bool get_unfiltered_request(long& bubble_cnt, long& req_addr, Request::Type& req_type, ulong& sector_bits, int& req_size, long& inst_addr, ulong& req_actual_access);
@@ -31,6 +37,9 @@ public:
     void populate_pretrace_buffer();
     bool dynamicOn = false;
 
+    // position in the trace and the pretrace buffer
+    void checkpoint(Checkpoint& ckpt);
+
     long expected_limit_insts = 0;
     ulong sector_size = 0;
     bool sectoredDRAM = false;
@@ -52,9 +61,37 @@ public:
     
     std::deque<Entry> pretrace_buffer;
 private:
+    // next load/store of a CPU trace, starting over at the end of the file
+    void read_record(BinaryTrace::Record& rec);
+
+    void push_pretrace(const Entry& entry);
+    void pop_pretrace();
+
+    // sector bits of the requests in pretrace_buffer, per cache block, kept
+    // for the lookahead predictor so that it does not scan the buffer
+    static const int MAX_SECTORS = 16;
+    struct BlockSectors
+    {
+        int entries = 0;
+        ulong sector_bits = 0;
+        int sector_count[MAX_SECTORS] = {}; // entries requesting each sector
+    };
+    std::unordered_map<long, BlockSectors> pretrace_sectors;
 
     std::ifstream file;
     std::string trace_name;
+
+    // binary traces (see TraceFormat.h) are memory-mapped instead of read through file
+    void* mapped = nullptr;
+    size_t mapped_size = 0;
+    const BinaryTrace::Record* records = nullptr;
+    long num_records = 0;
+    long next_record = 0;
+
+    // compressed traces are decoded by a reader thread, started with the first request
+    std::string decompress_command;
+    std::unique_ptr<TraceReader> reader;
+    long records_read = 0;
 };
 
 
@@ -63,22 +100,28 @@ public:
     int ipc = 4;
     int depth = 128;
 
-    Window() : ready_list(depth), addr_list(depth, -1), sector_list(depth, 0) {}
+    // line_mask selects the cache line of an address, set_ready() wakes the slots waiting on a line
+    Window(int ipc, int depth, long line_mask);
     bool is_full();
     bool is_empty();
+    bool can_retire();
     void insert(bool ready, long addr, ulong sectors);
     long retire();
-    void set_ready(long addr, int mask, ulong sector_bits);
+    void set_ready(long addr, ulong sector_bits);
     int size();
     void dump();
 
-    std::vector<bool> ready_list;
+    std::vector<char> ready_list;
     std::vector<long> addr_list;
     std::vector<ulong> sector_list;
     int tail = 0;
 private:
     int load = 0;
     int head = 0;
+    long line_mask;
+    // The slots that are not ready, per cache line, linked through next_waiter
+    std::unordered_map<long, int> first_waiter;
+    std::vector<int> next_waiter;
 };
 
 
@@ -102,6 +145,14 @@ public:
         function<bool(Request)> send_next, Cache* llc,
         std::shared_ptr<CacheSystem> cachesys, MemoryBase& memory);
     void tick();
+    // Functional warmup: sends the next trace request to the caches, which
+    // serve it at once (see Cache::warm)
+    void warm();
+    // Whether tick() would leave the core state unchanged (except for clk)
+    bool is_idle();
+    // Whether all requests of the core have been served
+    bool is_drained();
+    void checkpoint(Checkpoint& ckpt);
     void receive(Request& req);
     void reset_stats();
     double calc_ipc();
@@ -140,6 +191,8 @@ public:
     long expected_limit_insts;
     // This is set true iff expected number of instructions has been executed or all instructions are executed.
     bool reached_limit = false;
+    // When draining, the core only retires instructions and issues no new requests
+    bool draining = false;
     Window window;
 
 private:
@@ -159,6 +212,9 @@ private:
 
     Cache* first_level_cache = nullptr;
 
+    Request make_request();
+    void read_next_request();
+
     ScalarStat memory_access_cycles;
     ScalarStat cpu_inst;
     MemoryBase& memory;
@@ -170,8 +226,20 @@ public:
     Processor(const Config& configs, vector<const char*> trace_list,
         function<bool(Request)> send, MemoryBase& memory);
     void tick();
+    // Number of upcoming ticks that would only advance the clocks
+    long idle_cycles();
+    void skip(long cycles);
     void receive(Request& req);
     void reset_stats();
+    // Stop issuing requests, e.g., to take a checkpoint once is_drained()
+    void drain();
+    bool is_drained();
+    // Trace positions, caches and predictors, the processor must be drained
+    void checkpoint(Checkpoint& ckpt);
+    // Warm up the caches and predictors with warmup_insts instructions per core
+    // without the timing model (no instruction window, cache latencies or DRAM),
+    // returns false if the end of the traces is reached first
+    bool functional_warmup(long warmup_insts);
     // To correctly account for L3 used block statistics
 
     bool finished();
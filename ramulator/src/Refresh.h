@@ -82,6 +82,11 @@ public:
     }
   }
 
+  // The refresh clk at which the next refresh will be injected
+  long get_next() {
+    return refreshed + ctrl->channel->spec->speed_entry.nREFI;
+  }
+
 private:
   // Keeping track of refresh status of every bank: + means ahead of schedule, - means behind schedule
   vector<vector<int>*> bank_refresh_backlog;
@@ -97,7 +102,7 @@ private:
   // Refresh based on the specified address
   void refresh_target(Controller<T>* ctrl, int rank, int bank, int sa)
   {
-    vector<int> addr_vec(int(T::Level::MAX), -1);
+    AddrVec addr_vec(int(T::Level::MAX), -1);
     addr_vec[0] = ctrl->channel->id;
     addr_vec[1] = rank;
     addr_vec[2] = bank;
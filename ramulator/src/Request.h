@@ -11,6 +11,56 @@ typedef unsigned int uint;
 namespace ramulator
 {
 
+// Address of a request, one index per level of the memory organization. The
+// entries are kept inline so that requests can be copied without allocating.
+class AddrVec
+{
+public:
+    static const int MAX_LEVELS = 8;
+
+    AddrVec() {}
+    AddrVec(int size, int value = 0) {resize(size, value);}
+    AddrVec(const vector<int>& vec)
+    {
+        resize(vec.size());
+        for (int i = 0; i < len; i++)
+            vals[i] = vec[i];
+    }
+
+    int size() const {return len;}
+    bool empty() const {return len == 0;}
+    void resize(int size, int value = 0)
+    {
+        assert(size <= MAX_LEVELS);
+        for (int i = len; i < size; i++)
+            vals[i] = value;
+        len = size;
+    }
+
+    int* data() {return vals;}
+    const int* data() const {return vals;}
+    int* begin() {return vals;}
+    int* end() {return vals + len;}
+    const int* begin() const {return vals;}
+    const int* end() const {return vals + len;}
+    int& operator[](int i) {return vals[i];}
+    const int& operator[](int i) const {return vals[i];}
+
+    bool operator==(const AddrVec& other) const
+    {
+        if (len != other.len)
+            return false;
+        for (int i = 0; i < len; i++)
+            if (vals[i] != other.vals[i])
+                return false;
+        return true;
+    }
+
+private:
+    int vals[MAX_LEVELS];
+    int len = 0;
+};
+
 class Request
 {
 public:
@@ -19,7 +69,7 @@ public:
     bool cache_hit = false;
     int hit_level = 0;
     // long addr_row;
-    vector<int> addr_vec;
+    AddrVec addr_vec;
     //ulong sector_bits;
     ulong sector_bits [5]; // one level for the original request (from processor) 3 levels for a 3-level hierarchy + 1 level for the memory controller
     ulong actual_access; // which sector does this request want to bring?
@@ -42,8 +92,25 @@ public:
 
     long arrive = -1;
     long depart = -1;
+    long queue_seq = -1; // order of the request in its controller queue (see Controller::Queue)
     function<void(Request&)> callback; // call back with more info
 
+    // first command to issue and the clk at which it is ready, cached by the
+    // controller: the command until a command changes the state of the bank,
+    // the clk until the next command changes the timing of the channel. A
+    // copy of the request starts with an empty cache.
+    struct CmdCache
+    {
+        long state_version = -1;
+        long version = -1;
+        int cmd = -1;
+        long ready = -1;
+
+        CmdCache() {}
+        CmdCache(const CmdCache&) {}
+        CmdCache& operator=(const CmdCache&) {state_version = version = -1; return *this;}
+    } cmd_cache;
+
     Request(long addr, Type type, int coreid = 0)
         : is_first_command(true), addr(addr), coreid(coreid), type(type),
       callback([](Request& req){}) {}
@@ -52,33 +119,11 @@ public:
         : is_first_command(true), addr(addr), coreid(coreid), type(type), callback(callback) {}
 
 
-    Request(vector<int>& addr_vec, Type type, function<void(Request&)> callback, int coreid = 0)
+    Request(const AddrVec& addr_vec, Type type, function<void(Request&)> callback, int coreid = 0)
         : is_first_command(true), addr_vec(addr_vec), coreid(coreid), type(type), callback(callback) {}
 
     Request()
         : is_first_command(true), coreid(0) {}
-
-    Request(const Request& req) : is_first_command(req.is_first_command), addr(req.addr), coreid(req.coreid), type(req.type), callback(req.callback) 
-    {
-        //assert(false && "Why was I called???");
-
-        for (int i = 0; i < 5; i++)
-            sector_bits[i] = req.sector_bits[i];
-        arrive = req.arrive;
-        depart = req.depart;
-
-        actual_access = req.actual_access;
-        inst_addr = req.inst_addr;
-        size = req.size;
-        hit_level = req.hit_level;
-        cache_hit = req.cache_hit;
-
-        // copy addr_vec
-        addr_vec.resize(req.addr_vec.size());
-        for (int i = 0; i < req.addr_vec.size(); i++)
-            addr_vec[i] = req.addr_vec[i];
-    }
-
 };
 
 } /*namespace ramulator*/
@@ -18,15 +18,50 @@ Current Memory Scheduling Policies:
 3) FRFCFS_Cap - First Ready First Come First Serve Cap
        This scheduling policy behaves the same way as FRFCS, except that it has
        a cap on the number of hits you can get in a certain row. The CAP VALUE
-       can be altered by changing the number for the "cap" variable in 
-       line number 76. 
+       is set by the "scheduler_cap" config option (default 16).
 
 4) FRFCFS_PriorHit - First Ready First Come First Serve Prioritize Hits
        This scheduling policy behaves the same way as FRFCFS, except that it
        prioritizes row hits more than readiness. 
 
-You can select which scheduler you want to use by changing the value of 
-"type" variable on line number 74.
+5) FRFCFS_Sector - Sectored DRAM aware First Ready First Come First Serve
+       Among ready requests, this scheduling policy first serves true hits
+       (the row and all sectors of the request are open), then sector misses
+       (the row is open without some of the sectors), then the others.
+       An ACT that does not fit in the sector-weighted tFAW window of its
+       rank (see FAWTracker) is not ready. The sector misses to a row share
+       one re-activation that opens the sectors of all queued requests to
+       the row (see Controller::merge_row_sectors).
+
+Application-aware Memory Scheduling Policies:
+These rank the cores (Request::coreid) of a multiprogrammed workload and
+serve the requests of higher ranked cores first, then ready requests, then
+older requests. The ranks are kept per channel and updated at epoch
+boundaries, see the bliss_*, atlas_* and tcm_* stats. LLC write-backs
+carry the core whose request brought the block into the LLC, so they are
+ranked and counted as that core's requests.
+
+6) BLISS - Blacklisting memory scheduler
+       A core that is served bliss_threshold requests in a row is
+       blacklisted, its requests come after those of the other cores. The
+       blacklist is cleared every bliss_clearing_interval cycles.
+
+7) ATLAS - Adaptive per-Thread Least-Attained-Service scheduler
+       Ranks the cores by their attained service (the commands issued on
+       their behalf, as a proxy for the bank cycles they take), averaged
+       over the quanta of atlas_quantum cycles with atlas_alpha; the cores
+       that attained the least service come first. A request that waited
+       more than atlas_threshold cycles comes before all others.
+
+8) TCM - Thread Cluster Memory scheduler
+       Every tcm_quantum cycles, the cores that sent the fewest requests
+       in the quantum, up to tcm_cluster_thresh of all requests, form the
+       latency-sensitive cluster, ranked by their intensity above the
+       others. The bandwidth-sensitive cluster is ranked round-robin,
+       shifted every tcm_shuffle_interval cycles.
+
+You can select which scheduler you want to use with the "scheduler" config
+option (default FRFCFS_Cap).
 
                 _______________________________________
 
@@ -49,10 +84,14 @@ Current Row Policies:
 #include "DRAM.h"
 #include "Request.h"
 #include "Controller.h"
+#include "Statistics.h"
 #include <vector>
 #include <map>
 #include <list>
 #include <functional>
+#include <algorithm>
+#include <numeric>
+#include <climits>
 #include <cassert>
 
 using namespace std;
@@ -70,15 +109,181 @@ public:
     Controller<T>* ctrl;
 
     enum class Type {
-        FCFS, FRFCFS, FRFCFS_Cap, FRFCFS_PriorHit, MAX
-    } type = Type::FRFCFS_Cap; //Change this line to change scheduling policy
+        FCFS, FRFCFS, FRFCFS_Cap, FRFCFS_PriorHit, FRFCFS_Sector, BLISS, ATLAS, TCM, MAX
+    } type = Type::FRFCFS_Cap;
+
+    map<string, Type> name_to_type = {
+        {"FCFS", Type::FCFS},
+        {"FRFCFS", Type::FRFCFS},
+        {"FRFCFS_Cap", Type::FRFCFS_Cap},
+        {"FRFCFS_PriorHit", Type::FRFCFS_PriorHit},
+        {"FRFCFS_Sector", Type::FRFCFS_Sector},
+        {"BLISS", Type::BLISS},
+        {"ATLAS", Type::ATLAS},
+        {"TCM", Type::TCM},
+    };
+
+    long cap = 16;
 
-    long cap = 16; //Change this line to change cap
+    // application-aware policies, the parameters of the papers
+    int bliss_threshold = 4;
+    long bliss_clearing_interval = 10000;
+    long atlas_quantum = 10000000;
+    double atlas_alpha = 0.875;
+    long atlas_threshold = 100000;
+    long tcm_quantum = 1000000;
+    long tcm_shuffle_interval = 800;
+    double tcm_cluster_thresh = 4.0 / 24;
 
     bool debug = false;
 
     Scheduler(Controller<T>* ctrl) : ctrl(ctrl) {}
 
+    bool is_app_aware() const
+    {
+        return type == Type::BLISS || type == Type::ATLAS || type == Type::TCM;
+    }
+
+    // Sets up the per-core state of the application-aware policies and
+    // their stats, the stats of the other policies are not displayed
+    void init_cores(int cores)
+    {
+        core_prio.assign(cores, 0);
+        bliss_blacklisted.assign(cores, false);
+        atlas_quantum_service.assign(cores, 0);
+        atlas_total_service.assign(cores, 0.0);
+        tcm_requests.assign(cores, 0);
+        tcm_bandwidth_cluster.clear();
+        last_served_core = -1;
+        served_in_row = 0;
+
+        long clk = ctrl->clk;
+        bliss_next_clearing = clk + bliss_clearing_interval;
+        atlas_next_quantum = clk + atlas_quantum;
+        tcm_next_quantum = clk + tcm_quantum;
+        tcm_next_shuffle = clk + tcm_shuffle_interval;
+
+        string channel = to_string(ctrl->channel->id);
+        bliss_blacklistings
+            .init(cores)
+            .name("bliss_blacklistings_channel_"+channel)
+            .desc("Number of times BLISS blacklisted each core per channel")
+            .precision(0)
+            .flags(type == Type::BLISS ? Stats::display : 0)
+            ;
+        atlas_attained_service
+            .init(cores)
+            .name("atlas_attained_service_channel_"+channel)
+            .desc("Attained service of each core per channel at the last ATLAS quantum")
+            .precision(2)
+            .flags(type == Type::ATLAS ? Stats::display : 0)
+            ;
+        atlas_rank
+            .init(cores)
+            .name("atlas_rank_channel_"+channel)
+            .desc("ATLAS rank of each core per channel at the last quantum (0 is the highest)")
+            .precision(0)
+            .flags(type == Type::ATLAS ? Stats::display : 0)
+            ;
+        tcm_latency_cluster_quanta
+            .init(cores)
+            .name("tcm_latency_cluster_quanta_channel_"+channel)
+            .desc("Number of TCM quanta each core was in the latency-sensitive cluster per channel")
+            .precision(0)
+            .flags(type == Type::TCM ? Stats::display : 0)
+            ;
+        tcm_rank
+            .init(cores)
+            .name("tcm_rank_channel_"+channel)
+            .desc("TCM rank of each core per channel at the last quantum (0 is the highest)")
+            .precision(0)
+            .flags(type == Type::TCM ? Stats::display : 0)
+            ;
+    }
+
+    // Ends the epochs that are over by the current clk, true if that
+    // changed the ranks of the cores
+    bool tick()
+    {
+        long clk = ctrl->clk;
+        bool changed = false;
+        if (type == Type::BLISS && clk >= bliss_next_clearing) {
+            bliss_next_clearing = clk + bliss_clearing_interval;
+            if (find(bliss_blacklisted.begin(), bliss_blacklisted.end(), true) != bliss_blacklisted.end()) {
+                bliss_blacklisted.assign(bliss_blacklisted.size(), false);
+                core_prio.assign(core_prio.size(), 0);
+                changed = true;
+            }
+        }
+        if (type == Type::ATLAS && clk >= atlas_next_quantum) {
+            atlas_next_quantum = clk + atlas_quantum;
+            end_atlas_quantum();
+            changed = true;
+        }
+        if (type == Type::TCM && clk >= tcm_next_quantum) {
+            tcm_next_quantum = clk + tcm_quantum;
+            tcm_next_shuffle = clk + tcm_shuffle_interval;
+            end_tcm_quantum();
+            changed = true;
+        }
+        else if (type == Type::TCM && clk >= tcm_next_shuffle) {
+            tcm_next_shuffle = clk + tcm_shuffle_interval;
+            changed = shuffle_tcm_bandwidth_cluster();
+        }
+        return changed;
+    }
+
+    // The earliest clk at which the ranks of the cores may change without a
+    // command being issued (see Controller::next_event())
+    long next_event()
+    {
+        switch (type) {
+            case Type::BLISS:
+                return bliss_next_clearing;
+            case Type::ATLAS: {
+                long next = atlas_next_quantum;
+                // a request that reaches the threshold jumps ahead of the others
+                for (auto queue : {&ctrl->actq, &ctrl->readq, &ctrl->writeq})
+                    for (auto& req : queue->q)
+                        if (req.arrive + atlas_threshold + 1 > ctrl->last_sched_clk)
+                            next = min(next, req.arrive + atlas_threshold + 1);
+                return next;
+            }
+            case Type::TCM:
+                return min(tcm_next_quantum, tcm_next_shuffle);
+            default:
+                return LONG_MAX;
+        }
+    }
+
+    // Called for every command issued on behalf of req, finished if it is
+    // the last command of req
+    void issued(const Request& req, bool finished)
+    {
+        if (!is_app_aware() || req.type == Request::Type::REFRESH)
+            return;
+        int coreid = req.coreid;
+        if (type == Type::ATLAS)
+            atlas_quantum_service[coreid]++;
+        if (!finished)
+            return;
+        if (type == Type::TCM)
+            tcm_requests[coreid]++;
+        if (type == Type::BLISS) {
+            if (coreid == last_served_core) {
+                served_in_row++;
+            } else {
+                last_served_core = coreid;
+                served_in_row = 1;
+            }
+            if (served_in_row >= bliss_threshold && !bliss_blacklisted[coreid]) {
+                bliss_blacklisted[coreid] = true;
+                core_prio[coreid] = -1;
+                ++bliss_blacklistings[coreid];
+            }
+        }
+    }
+
     list<list<Request>::iterator> get_parallel_request(list<Request>& q, list<Request>::iterator req) 
     {
         list<list<Request>::iterator> reqs;
@@ -112,86 +317,280 @@ public:
         }
         return true;
     }
-    list<Request>::iterator get_head(list<Request>& q)
+    list<Request>::iterator get_head(typename Controller<T>::Queue& queue)
     {
+        auto& q = queue.q;
+
+        //If queue is empty, return end of queue
+        if (!q.size())
+            return q.end();
+
         // TODO make the decision at compile time
-        if (type != Type::FRFCFS_PriorHit) {
-            //If queue is empty, return end of queue
-            if (!q.size())
-                return q.end();
+        if (type == Type::FRFCFS_Sector || is_app_aware()) {
+            // the priority of these depends on the sectors or the core of
+            // each request, so all of them are candidates
+            candidates.clear();
+            for (auto itr = q.begin(); itr != q.end(); itr++)
+                candidates.push_back(itr);
+        } else {
+            get_candidates(queue);
+        }
 
+        if (type == Type::FRFCFS_Sector) {
+            // a sector miss waits for the hits to its row, so that it
+            // re-activates the row once for the sectors of all of them
+            return get_head_without_violating_hits(q, Type::FRFCFS_Sector);
+        }
+        else if (type != Type::FRFCFS_PriorHit) {
             //Else return based on the policy
-            auto head = q.begin();
-            for (auto itr = next(q.begin(), 1); itr != q.end(); itr++)
-                head = compare[int(type)](head, itr);
+            auto head = candidates[0];
+            for (size_t i = 1; i < candidates.size(); i++)
+                head = compare_in_order(type, head, candidates[i]);
 
             return head;
         } 
         else { //Code to get around edge cases for FRFCFS_PriorHit
-            
-       //If queue is empty, return end of queue
-            if (!q.size())
-                return q.end();
 
        //Else return based on FRFCFS_PriorHit Scheduling Policy
-            auto head = q.begin();
-            for (auto itr = next(q.begin(), 1); itr != q.end(); itr++) {
-                head = compare[int(Type::FRFCFS_PriorHit)](head, itr);
+            auto head = candidates[0];
+            for (size_t i = 1; i < candidates.size(); i++) {
+                head = compare_in_order(Type::FRFCFS_PriorHit, head, candidates[i]);
             }
 
             if (this->ctrl->is_ready(head) && this->ctrl->is_row_hit(head)) {
                 return head;
             }
 
-            // prepare a list of hit request
-            vector<vector<int>> hit_reqs;
-            for (auto itr = q.begin() ; itr != q.end() ; ++itr) {
-                if (this->ctrl->is_row_hit(itr)) {
-                    auto begin = itr->addr_vec.begin();
-                    // TODO Here it assumes all DRAM standards use PRE to close a row
-                    // It's better to make it more general.
-                    auto end = begin + int(ctrl->channel->spec->scope[int(T::Command::PRE)]) + 1;
-                    vector<int> rowgroup(begin, end); // bank or subarray
-                    hit_reqs.push_back(rowgroup);
-                }
+            return get_head_without_violating_hits(q, Type::FRFCFS);
+        }
+    }
+
+//Compare functions for each memory schedulers
+private:
+    typedef list<Request>::iterator ReqIter;
+
+    // the rank of each core, higher is served first (application-aware policies)
+    vector<int> core_prio;
+
+    // BLISS
+    vector<bool> bliss_blacklisted;
+    int last_served_core = -1;
+    int served_in_row = 0;
+    long bliss_next_clearing = 0;
+    VectorStat bliss_blacklistings;
+
+    // ATLAS
+    vector<long> atlas_quantum_service;
+    vector<double> atlas_total_service;
+    long atlas_next_quantum = 0;
+    VectorStat atlas_attained_service;
+    VectorStat atlas_rank;
+
+    // TCM
+    vector<long> tcm_requests;
+    vector<int> tcm_bandwidth_cluster; // the cores of the cluster, from the highest rank
+    long tcm_next_quantum = 0;
+    long tcm_next_shuffle = 0;
+    VectorStat tcm_latency_cluster_quanta;
+    VectorStat tcm_rank;
+
+    // ranks the cores from the highest to the lowest rank
+    void rank_cores(const vector<int>& cores)
+    {
+        for (int rank = 0; rank < int(cores.size()); rank++)
+            core_prio[cores[rank]] = int(cores.size()) - rank;
+    }
+
+    void end_atlas_quantum()
+    {
+        int cores = core_prio.size();
+        for (int core = 0; core < cores; core++) {
+            atlas_total_service[core] = atlas_alpha * atlas_total_service[core]
+                                        + (1 - atlas_alpha) * atlas_quantum_service[core];
+            atlas_quantum_service[core] = 0;
+            atlas_attained_service[core] = atlas_total_service[core];
+        }
+        vector<int> order(cores);
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [this] (int core1, int core2) {
+            return atlas_total_service[core1] < atlas_total_service[core2];});
+        rank_cores(order);
+        for (int rank = 0; rank < cores; rank++)
+            atlas_rank[order[rank]] = rank;
+    }
+
+    void end_tcm_quantum()
+    {
+        int cores = core_prio.size();
+        vector<int> order(cores);
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [this] (int core1, int core2) {
+            return tcm_requests[core1] < tcm_requests[core2];});
+
+        long total = accumulate(tcm_requests.begin(), tcm_requests.end(), 0L);
+        long latency_cluster_requests = 0;
+        int latency_cluster = 0;
+        for (; latency_cluster < cores; latency_cluster++) {
+            latency_cluster_requests += tcm_requests[order[latency_cluster]];
+            if (latency_cluster_requests > tcm_cluster_thresh * total)
+                break;
+            ++tcm_latency_cluster_quanta[order[latency_cluster]];
+        }
+        tcm_bandwidth_cluster.assign(order.begin() + latency_cluster, order.end());
+        tcm_requests.assign(cores, 0);
+
+        rank_cores(order);
+        for (int rank = 0; rank < cores; rank++)
+            tcm_rank[order[rank]] = rank;
+    }
+
+    // rotates the ranks of the bandwidth-sensitive cluster by one, so that
+    // each of its cores gets the highest rank of the cluster in turn
+    bool shuffle_tcm_bandwidth_cluster()
+    {
+        if (tcm_bandwidth_cluster.size() < 2)
+            return false;
+        rotate(tcm_bandwidth_cluster.begin(), tcm_bandwidth_cluster.begin() + 1,
+               tcm_bandwidth_cluster.end());
+        for (int rank = 0; rank < int(tcm_bandwidth_cluster.size()); rank++)
+            core_prio[tcm_bandwidth_cluster[rank]] = int(tcm_bandwidth_cluster.size()) - rank;
+        return true;
+    }
+
+    // application-aware policies: the higher ranked core, then the ready
+    // request, then the older request
+    ReqIter compare_ranked(ReqIter req1, ReqIter req2)
+    {
+        int prio1 = this->core_prio[req1->coreid];
+        int prio2 = this->core_prio[req2->coreid];
+        if (type == Type::ATLAS) {
+            // over the threshold above all ranks
+            long clk = this->ctrl->clk;
+            if (clk - req1->arrive > atlas_threshold)
+                prio1 = INT_MAX;
+            if (clk - req2->arrive > atlas_threshold)
+                prio2 = INT_MAX;
+        }
+
+        if (prio1 != prio2) {
+            if (prio1 > prio2) return req1;
+            return req2;
+        }
+
+        bool ready1 = this->ctrl->is_ready(req1);
+        bool ready2 = this->ctrl->is_ready(req2);
+
+        if (ready1 ^ ready2) {
+            if (ready1) return req1;
+            return req2;
+        }
+
+        if (req1->arrive <= req2->arrive) return req1;
+        return req2;
+    }
+
+    vector<ReqIter> candidates; // of get_head()
+
+    // The requests of queue that may be the head under FCFS, FRFCFS,
+    // FRFCFS_Cap and FRFCFS_PriorHit: for each rowgroup, the
+    // requests to its open row and the oldest of the others. The first
+    // command of the others is the same ACT or PRE, so they are equally ready
+    // and no row hits, and only their arrival orders them. This keeps head
+    // selection proportional to the rowgroups with requests rather than to
+    // the queue size.
+    void get_candidates(typename Controller<T>::Queue& queue)
+    {
+        candidates.clear();
+        for (auto& rowgroup : queue.rowgroups) {
+            auto& reqs = rowgroup.second; // the oldest first
+            int open_row = ctrl->rowtable->get_open_row((*reqs.begin())->addr_vec);
+            if (open_row < 0) {
+                candidates.push_back(*reqs.begin());
+                continue;
             }
-            // if we can't find proper request, we need to return q.end(),
-            // so that no command will be scheduled
-            head = q.end();
-            for (auto itr = q.begin(); itr != q.end(); itr++) {
-                bool violate_hit = false;
-                if ((!this->ctrl->is_row_hit(itr)) && this->ctrl->is_row_open(itr)) {
-                    // so the next instruction to be scheduled is PRE, might violate hit
-                    auto begin = itr->addr_vec.begin();
-                    // TODO Here it assumes all DRAM standards use PRE to close a row
-                    // It's better to make it more general.
-                    auto end = begin + int(ctrl->channel->spec->scope[int(T::Command::PRE)]) + 1;
-                    vector<int> rowgroup(begin, end); // bank or subarray
-                    for (const auto& hit_req_rowgroup : hit_reqs) {
-                        if (rowgroup == hit_req_rowgroup) {
-                            violate_hit = true;
-                            break;
-                        }  
-                    }
-                }
-                if (violate_hit) {
-                    continue;
-                }
-                // If it comes here, that means it won't violate any hit request
-                if (head == q.end()) {
-                    head = itr;
-                } else {
-                    head = compare[int(Type::FRFCFS)](head, itr);
+            for (auto req : reqs) {
+                if (req->addr_vec[int(T::Level::Row)] != open_row) {
+                    candidates.push_back(req);
+                    break;
                 }
             }
+            auto same_row = queue.get_row(rowgroup.first, open_row);
+            if (same_row)
+                candidates.insert(candidates.end(), same_row->begin(), same_row->end());
+        }
+    }
 
-            return head;
+    // compare[policy] with the request that is earlier in the queue first,
+    // which wins ties, so that folding the candidates in any order gives the
+    // head of a fold over the whole queue
+    ReqIter compare_in_order(Type policy, ReqIter req1, ReqIter req2)
+    {
+        if (req1->queue_seq < req2->queue_seq)
+            return compare[int(policy)](req1, req2);
+        return compare[int(policy)](req2, req1);
+    }
+
+    // The highest priority request under policy among the candidates whose
+    // next command is not a PRE that closes a row other candidates hit in.
+    // q.end() if there is none, so that no command will be scheduled.
+    ReqIter get_head_without_violating_hits(list<Request>& q, Type policy)
+    {
+        // prepare a list of hit request
+        vector<vector<int>> hit_reqs;
+        for (auto itr : candidates) {
+            if (this->ctrl->is_row_hit(itr)) {
+                auto begin = itr->addr_vec.begin();
+                // TODO Here it assumes all DRAM standards use PRE to close a row
+                // It's better to make it more general.
+                auto end = begin + int(ctrl->channel->spec->scope[int(T::Command::PRE)]) + 1;
+                vector<int> rowgroup(begin, end); // bank or subarray
+                hit_reqs.push_back(rowgroup);
+            }
         }
+        auto head = q.end();
+        for (auto itr : candidates) {
+            bool violate_hit = false;
+            if ((!this->ctrl->is_row_hit(itr)) && this->ctrl->is_row_open(itr)) {
+                // so the next instruction to be scheduled is PRE, might violate hit
+                auto begin = itr->addr_vec.begin();
+                // TODO Here it assumes all DRAM standards use PRE to close a row
+                // It's better to make it more general.
+                auto end = begin + int(ctrl->channel->spec->scope[int(T::Command::PRE)]) + 1;
+                vector<int> rowgroup(begin, end); // bank or subarray
+                for (const auto& hit_req_rowgroup : hit_reqs) {
+                    if (rowgroup == hit_req_rowgroup) {
+                        violate_hit = true;
+                        break;
+                    }  
+                }
+            }
+            if (violate_hit) {
+                continue;
+            }
+            // If it comes here, that means it won't violate any hit request
+            if (head == q.end()) {
+                head = itr;
+            } else {
+                head = compare_in_order(policy, head, itr);
+            }
+        }
+
+        return head;
+    }
+
+    // FRFCFS_Sector: ready true hits, then ready sector misses, then the
+    // other ready requests, then the requests that are not ready
+    int sector_priority(ReqIter req)
+    {
+        if (!this->ctrl->is_ready(req) || !this->ctrl->fits_faw_budget(req))
+            return 0;
+        if (this->ctrl->is_row_hit(req))
+            return 3;
+        if (this->ctrl->is_sector_miss(req))
+            return 2;
+        return 1;
     }
 
-//Compare functions for each memory schedulers
-private:
-    typedef list<Request>::iterator ReqIter;
     function<ReqIter(ReqIter, ReqIter)> compare[int(Type::MAX)] = {
         // FCFS
         [this] (ReqIter req1, ReqIter req2) {
@@ -237,7 +636,32 @@ private:
             }
 
             if (req1->arrive <= req2->arrive) return req1;
-            return req2;}
+            return req2;},
+
+        // FRFCFS_Sector
+        [this] (ReqIter req1, ReqIter req2) {
+            int prio1 = this->sector_priority(req1);
+            int prio2 = this->sector_priority(req2);
+
+            if (prio1 != prio2) {
+                if (prio1 > prio2) return req1;
+                return req2;
+            }
+
+            if (req1->arrive <= req2->arrive) return req1;
+            return req2;},
+
+        // BLISS
+        [this] (ReqIter req1, ReqIter req2) {
+            return this->compare_ranked(req1, req2);},
+
+        // ATLAS
+        [this] (ReqIter req1, ReqIter req2) {
+            return this->compare_ranked(req1, req2);},
+
+        // TCM
+        [this] (ReqIter req1, ReqIter req2) {
+            return this->compare_ranked(req1, req2);}
     };
 };
 
@@ -257,46 +681,58 @@ public:
 
     RowPolicy(Controller<T>* ctrl) : ctrl(ctrl) {}
 
-    vector<int> get_victim(typename T::Command cmd)
+    AddrVec get_victim(typename T::Command cmd)
     {
         return policy[int(type)](cmd);
     }
 
 private:
-    function<vector<int>(typename T::Command)> policy[int(Type::MAX)] = {
+    function<AddrVec(typename T::Command)> policy[int(Type::MAX)] = {
         // Closed
-        [this] (typename T::Command cmd) -> vector<int> {
-            for (auto& kv : this->ctrl->rowtable->table) {
-                if (!this->ctrl->is_ready(cmd, kv.first))
+        [this] (typename T::Command cmd) -> AddrVec {
+            auto rowtable = this->ctrl->rowtable;
+            for (int id = 0, open = 0; open < rowtable->num_open; id++) {
+                if (!rowtable->is_open(id))
                     continue;
-                return kv.first;
+                open++;
+                if (!this->ctrl->is_ready(cmd, rowtable->rowgroups[id]))
+                    continue;
+                return rowtable->rowgroups[id];
             }
-            return vector<int>();},
+            return AddrVec();},
 
         // ClosedAP
-        [this] (typename T::Command cmd) -> vector<int> {
-            for (auto& kv : this->ctrl->rowtable->table) {
-                if (!this->ctrl->is_ready(cmd, kv.first))
+        [this] (typename T::Command cmd) -> AddrVec {
+            auto rowtable = this->ctrl->rowtable;
+            for (int id = 0, open = 0; open < rowtable->num_open; id++) {
+                if (!rowtable->is_open(id))
+                    continue;
+                open++;
+                if (!this->ctrl->is_ready(cmd, rowtable->rowgroups[id]))
                     continue;
-                return kv.first;
+                return rowtable->rowgroups[id];
             }
-            return vector<int>();},
+            return AddrVec();},
 
         // Opened
         [this] (typename T::Command cmd) {
-            return vector<int>();},
+            return AddrVec();},
 
         // Timeout
-        [this] (typename T::Command cmd) -> vector<int> {
-            for (auto& kv : this->ctrl->rowtable->table) {
-                auto& entry = kv.second;
+        [this] (typename T::Command cmd) -> AddrVec {
+            auto rowtable = this->ctrl->rowtable;
+            for (int id = 0, open = 0; open < rowtable->num_open; id++) {
+                if (!rowtable->is_open(id))
+                    continue;
+                open++;
+                auto& entry = rowtable->table[id];
                 if (this->ctrl->clk - entry.timestamp < timeout)
                     continue;
-                if (!this->ctrl->is_ready(cmd, kv.first))
+                if (!this->ctrl->is_ready(cmd, rowtable->rowgroups[id]))
                     continue;
-                return kv.first;
+                return rowtable->rowgroups[id];
             }
-            return vector<int>();}
+            return AddrVec();}
     };
 
 };
@@ -312,31 +748,79 @@ public:
         int row;
         int hits;
         long timestamp;
+        long version; // incremented by every command that changes the state of the rowgroup
     };
 
-    map<vector<int>, Entry> table;
+    // One entry per rowgroup (bank or subarray) of the channel, indexed by the
+    // flattened rowgroup id, in the same order as the rowgroup addresses.
+    // row is -1 if the rowgroup has no open row.
+    vector<Entry> table;
+    vector<AddrVec> rowgroups; // the address (levels above Row) of each entry
+    int num_open = 0;
+
+    RowTable(Controller<T>* ctrl) : ctrl(ctrl)
+    {
+        int* count = ctrl->channel->spec->org_entry.count;
+        int size = 1;
+        for (int l = int(T::Level::Row) - 1; l > 0; l--) {
+            stride[l] = size;
+            size *= max(count[l], 1);
+        }
+        stride[0] = size;
+
+        table.assign(size, {-1, 0, 0, 0});
+        rowgroups.resize(size);
+        for (int i = 0; i < size; i++) {
+            rowgroups[i].resize(int(T::Level::Row));
+            rowgroups[i][0] = ctrl->channel->id;
+            for (int l = 1; l < int(T::Level::Row); l++)
+                rowgroups[i][l] = i / stride[l] % max(count[l], 1);
+        }
+    }
+
+    bool is_open(int id) {return table[id].row != -1;}
 
-    RowTable(Controller<T>* ctrl) : ctrl(ctrl) {}
+    // The entry of the open row in the rowgroup of addr_vec, nullptr if none is open
+    Entry* find(const AddrVec& addr_vec)
+    {
+        int id = get_id(addr_vec, int(T::Level::Row) - 1);
+        if (id < 0 || !is_open(id))
+            return nullptr;
+        return &table[id];
+    }
 
-    void update(typename T::Command cmd, const vector<int>& addr_vec, long clk)
+    void update(typename T::Command cmd, const AddrVec& addr_vec, long clk)
     {
-        auto begin = addr_vec.begin();
-        auto end = begin + int(T::Level::Row);
-        vector<int> rowgroup(begin, end); // bank or subarray
-        int row = *end;
+        int row = addr_vec[int(T::Level::Row)];
 
         T* spec = ctrl->channel->spec;
 
-        if (spec->is_opening(cmd))
-            table.insert({rowgroup, {row, 0, clk}});
+        // the first command of a request may depend on the state of its
+        // whole bank (e.g., the open subarray in SALP), so a command changes
+        // the version of all rowgroups of at least its bank. The rowgroups in
+        // scope are contiguous.
+        int version_scope = min(int(spec->scope[int(cmd)]), int(T::Level::Bank));
+        int first = get_id(addr_vec, version_scope);
+        for (int id = first; id < first + stride[version_scope]; id++)
+            table[id].version++;
+
+        if (spec->is_opening(cmd)) {
+            int id = get_id(addr_vec, int(T::Level::Row) - 1);
+            if (!is_open(id)) {
+                table[id].row = row;
+                table[id].hits = 0;
+                table[id].timestamp = clk;
+                num_open++;
+            }
+        }
 
         if (spec->is_accessing(cmd)) {
             // we are accessing a row -- update its entry
-            auto match = table.find(rowgroup);
-            assert(match != table.end());
-            assert(match->second.row == row);
-            match->second.hits++;
-            match->second.timestamp = clk;
+            auto match = find(addr_vec);
+            assert(match != nullptr);
+            assert(match->row == row);
+            match->hits++;
+            match->timestamp = clk;
         } /* accessing */
 
         if (spec->is_closing(cmd)) {
@@ -346,50 +830,62 @@ public:
           if (spec->is_accessing(cmd))
             scope = int(T::Level::Row) - 1; //special condition for RDA and WRA
           else
-            scope = int(spec->scope[int(cmd)]);
+            scope = min(int(spec->scope[int(cmd)]), int(T::Level::Row) - 1);
 
-          for (auto it = table.begin(); it != table.end();) {
-            if (equal(begin, begin + scope + 1, it->first.begin())) {
+          // the rowgroups in scope are contiguous
+          int first = get_id(addr_vec, scope);
+          for (int id = first; id < first + stride[scope]; id++) {
+            if (is_open(id)) {
               n_rm++;
-              it = table.erase(it);
+              table[id].row = -1;
             }
-            else
-              it++;
           }
+          num_open -= n_rm;
 
           assert(n_rm > 0);
         } /* closing */
     }
 
-    int get_hits(const vector<int>& addr_vec, const bool to_opened_row = false)
+    int get_hits(const AddrVec& addr_vec, const bool to_opened_row = false)
     {
-        auto begin = addr_vec.begin();
-        auto end = begin + int(T::Level::Row);
-
-        vector<int> rowgroup(begin, end);
-        int row = *end;
-
-        auto itr = table.find(rowgroup);
-        if (itr == table.end())
+        auto itr = find(addr_vec);
+        if (itr == nullptr)
             return 0;
 
-        if(!to_opened_row && (itr->second.row != row))
+        if(!to_opened_row && (itr->row != addr_vec[int(T::Level::Row)]))
             return 0;
 
-        return itr->second.hits;
+        return itr->hits;
     }
 
-    int get_open_row(const vector<int>& addr_vec) {
-        auto begin = addr_vec.begin();
-        auto end = begin + int(T::Level::Row);
-
-        vector<int> rowgroup(begin, end);
+    // the version of the rowgroup of addr_vec, -1 if addr_vec has no rowgroup
+    long get_version(const AddrVec& addr_vec)
+    {
+        int id = get_id(addr_vec, int(T::Level::Row) - 1);
+        return id < 0 ? -1 : table[id].version;
+    }
 
-        auto itr = table.find(rowgroup);
-        if(itr == table.end())
+    int get_open_row(const AddrVec& addr_vec) {
+        auto itr = find(addr_vec);
+        if(itr == nullptr)
             return -1;
 
-        return itr->second.row;
+        return itr->row;
+    }
+
+private:
+    int stride[int(T::Level::Row)]; // number of rowgroups below a node of each level
+
+    // Flattened id of the first rowgroup below the node addressed by the levels up to scope
+    int get_id(const AddrVec& addr_vec, int scope)
+    {
+        int id = 0;
+        for (int l = 1; l <= scope; l++) {
+            if (addr_vec[l] < 0)
+                return -1;
+            id += addr_vec[l] * stride[l];
+        }
+        return id;
     }
 };
 
@@ -1,4 +1,5 @@
 #include "SpatialPredictor.h"
+#include "Checkpoint.h"
 
 #include <iostream>
 #include <cmath>
@@ -168,4 +169,15 @@ void SpatialPredictor::update_rolling_average_util(ulong pb_bv)
 
     assert(rolling_average <= 8);
     assert(rolling_average >= 0);
-}
\ No newline at end of file
+}
+
+void SpatialPredictor::checkpoint(ramulator::Checkpoint& ckpt)
+{
+    ckpt.io(pattern_table);
+    ckpt.io(tag_array);
+    ckpt.io(way_meta);
+    ckpt.io(rolling_average_utilization);
+    ckpt.io(rolling_average);
+    ckpt.io(rolling_average_counter);
+    ckpt.io(hashtable);
+}
@@ -7,6 +7,8 @@
 #include "Request.h"
 #include "Statistics.h"
 
+namespace ramulator { class Checkpoint; }
+
 class SpatialPredictor
 {
 
@@ -14,6 +16,7 @@ public:
     SpatialPredictor(const ramulator::Config& configs, const int id);
     ulong predict(ulong inst_addr, ulong load_addr);
     void update(ulong inst_addr, ulong load_addr, ulong pb_bv);
+    void checkpoint(ramulator::Checkpoint& ckpt);
 
 private:
     int coreid = 0;
@@ -148,7 +148,7 @@ public:
         int refresh_interval = channel->spec->speed_entry.nREFI;
         if (clk - refreshed >= refresh_interval) {
             auto req_type = Request::Type::REFRESH;
-            vector<int> addr_vec(int(T::Level::MAX), -1);
+            AddrVec addr_vec(int(T::Level::MAX), -1);
             addr_vec[0] = channel->id;
             for (auto child : channel->children) {
                 addr_vec[1] = child->id;
@@ -211,7 +211,7 @@ private:
         }
         // return channel->decode(cmd, req.addr_vec.data());
     }
-    void update(typename T::Command cmd, bool state_change, vector<int>::iterator& begin, vector<int>::iterator& end, request_queue& q){
+    void update(typename T::Command cmd, bool state_change, int*& begin, int*& end, request_queue& q){
         if (q.empty()) return;
 
         for (auto& info : q) {
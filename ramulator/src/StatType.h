@@ -8,7 +8,11 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+
+#include "StatsFormat.h"
 
 namespace ramulator {
 
@@ -79,6 +83,10 @@ class StatBase {
   virtual VResult vresult() const { return VResult(); };
   virtual Result total() const { return Result(); };
 
+  // one column for each value that print() writes, see StatList::snapshot
+  virtual void columns(std::vector<ramulator::EpochStats::Column>&) const {}
+  virtual void values(VResult&) const {}
+
   virtual bool is_display() const  = 0;
   virtual bool is_nozero() const = 0;
 };
@@ -87,6 +95,37 @@ class StatList {
  protected:
   std::vector<StatBase*> list;
   std::ofstream stat_output;
+
+  // Epoch snapshots, see StatsFormat.h
+  FILE* snapshot_file = nullptr;
+  bool snapshot_delta = false;
+  Tick snapshot_cycle = 0; // of the last snapshot, 0 is none
+  std::vector<StatBase*> snapshot_stats;
+  VResult snapshot_last, snapshot_values;
+  std::vector<ramulator::EpochStats::Entry> snapshot_entries;
+
+  void write_schema() {
+    using namespace ramulator;
+    std::vector<EpochStats::Column> cols;
+    for (auto stat : list) {
+      if (stat && stat->is_display()) {
+        snapshot_stats.push_back(stat);
+        stat->columns(cols);
+      }
+    }
+    EpochStats::Header header;
+    memcpy(header.magic, EpochStats::MAGIC, sizeof(header.magic));
+    header.version = EpochStats::VERSION;
+    header.flags = snapshot_delta ? EpochStats::DELTA : 0;
+    header.columns = cols.size();
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, snapshot_file);
+    for (auto& col : cols) {
+      EpochStats::write_string(snapshot_file, col.name);
+      EpochStats::write_string(snapshot_file, col.coreid);
+    }
+    snapshot_last.assign(cols.size(), Result());
+  }
  public:
   void add(StatBase* stat) {
     list.push_back(stat);
@@ -112,8 +151,60 @@ class StatList {
       }
     }
   }
+  void snapshot_output(std::string filename, bool delta) {
+    snapshot_file = fopen(filename.c_str(), "wb");
+    if (!snapshot_file) {
+      fprintf(stderr, "Cannot open the epoch stats file %s\n", filename.c_str());
+      exit(1);
+    }
+    snapshot_delta = delta;
+  }
+  Tick last_snapshot() const {
+    return snapshot_cycle;
+  }
+  // writes the stats that changed since the last snapshot
+  void snapshot(Tick cycle) {
+    if (!snapshot_file) {
+      return;
+    }
+    if (snapshot_stats.empty()) {
+      write_schema();
+    }
+    snapshot_values.clear();
+    for (auto stat : snapshot_stats) {
+      stat->prepare();
+      stat->values(snapshot_values);
+    }
+    assert(snapshot_values.size() == snapshot_last.size());
+
+    snapshot_entries.clear();
+    for (off_type i = 0 ; i < snapshot_values.size() ; ++i) {
+      if (memcmp(&snapshot_values[i], &snapshot_last[i], sizeof(Result)) == 0) {
+        continue;
+      }
+      ramulator::EpochStats::Entry entry;
+      entry.column = i;
+      entry.reserved = 0;
+      entry.value = snapshot_delta ? snapshot_values[i] - snapshot_last[i] : snapshot_values[i];
+      snapshot_entries.push_back(entry);
+    }
+    snapshot_last.swap(snapshot_values);
+    snapshot_cycle = cycle;
+
+    ramulator::EpochStats::Record rec;
+    rec.cycle = cycle;
+    rec.entries = snapshot_entries.size();
+    rec.reserved = 0;
+    fwrite(&rec, sizeof(rec), 1, snapshot_file);
+    fwrite(snapshot_entries.data(), sizeof(ramulator::EpochStats::Entry), snapshot_entries.size(), snapshot_file);
+    // a preempted simulation keeps the snapshots written so far
+    fflush(snapshot_file);
+  }
   ~StatList() {
     stat_output.close();
+    if (snapshot_file) {
+      fclose(snapshot_file);
+    }
   }
 };
 
@@ -201,6 +292,13 @@ class ScalarBase: public Stat<ScalarType> {
   size_type size() const {return 1;}
   VResult vresult() const {return VResult(1, result());}
 
+  void columns(std::vector<ramulator::EpochStats::Column>& cols) const {
+    cols.push_back({Stat<ScalarType>::_name, Stat<ScalarType>::_coreid});
+  }
+  void values(VResult& vals) const {
+    vals.push_back(result());
+  }
+
   void print(std::ofstream& file) {
     file << Stat<ScalarType>::_name << "," << Stat<ScalarType>::_coreid << ",";
     // TODO deal with flag
@@ -401,6 +499,22 @@ class VectorBase: public Stat<Derived> {
       data[i].reset();
     }
   }
+  void columns(std::vector<ramulator::EpochStats::Column>& cols) const {
+    cols.push_back({Stat<Derived>::_name, Stat<Derived>::_coreid});
+    if (size() > 1) {
+      for (off_type i = 0 ; i < size() ; ++i) {
+        cols.push_back({Stat<Derived>::_name, std::to_string(i)});
+      }
+    }
+  }
+  void values(VResult& vals) const {
+    vals.push_back(total());
+    if (size() > 1) {
+      for (off_type i = 0 ; i < size() ; ++i) {
+        vals.push_back(data[i].result());
+      }
+    }
+  }
   void print(std::ofstream& file) {
     
     file << Stat<Derived>::_name << "," << Stat<Derived>::_coreid << ",";
@@ -0,0 +1,141 @@
+#ifndef __STATS_FORMAT_H
+#define __STATS_FORMAT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ramulator
+{
+
+/*
+  Epoch statistics: periodic snapshots of all displayed stats (see
+  StatList::snapshot). The file starts with a header and the schema, one
+  column per value of the CSV stats output (a name and a core id, both
+  length-prefixed). Every snapshot is a record header followed by an entry
+  for each column that changed since the previous snapshot, so stats that
+  stay constant cost nothing. With the delta flag, an entry holds the change
+  of the column in the epoch instead of its value.
+  Values are stored in the byte order of the machine that wrote them.
+*/
+namespace EpochStats
+{
+    const char MAGIC[8] = {'R', 'A', 'M', 'S', 'T', 'A', 'T', 'S'};
+    const uint32_t VERSION = 1;
+    const uint32_t DELTA = 1; // header flag
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint32_t columns;
+        uint32_t reserved;
+    };
+
+    struct Record
+    {
+        uint64_t cycle;
+        uint32_t entries;
+        uint32_t reserved;
+    };
+
+    struct Entry
+    {
+        uint32_t column;
+        uint32_t reserved;
+        double value;
+    };
+
+    static_assert(sizeof(Header) == 24, "unexpected epoch stats header layout");
+    static_assert(sizeof(Record) == 16, "unexpected epoch stats record layout");
+    static_assert(sizeof(Entry) == 16, "unexpected epoch stats entry layout");
+
+    struct Column
+    {
+        std::string name;
+        std::string coreid;
+    };
+
+    inline void write_string(FILE* file, const std::string& str)
+    {
+        uint16_t len = str.size();
+        fwrite(&len, sizeof(len), 1, file);
+        fwrite(str.data(), 1, len, file);
+    }
+
+    inline bool read_string(FILE* file, std::string& str)
+    {
+        uint16_t len;
+        if (fread(&len, sizeof(len), 1, file) != 1)
+            return false;
+        str.resize(len);
+        return len == 0 || fread(&str[0], 1, len, file) == len;
+    }
+
+    // Reads the snapshots in order. values holds every column at the last
+    // snapshot read: the value of the stat, or its change in the epoch for
+    // a delta file.
+    class Reader
+    {
+    public:
+        Header header;
+        std::vector<Column> columns;
+        std::vector<double> values;
+        uint64_t cycle = 0;
+
+        // returns false if the file is not an epoch stats file
+        bool open(const char* fname)
+        {
+            file = fopen(fname, "rb");
+            if (!file || fread(&header, sizeof(header), 1, file) != 1)
+                return false;
+            if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+                return false;
+            columns.resize(header.columns);
+            for (auto& col : columns)
+                if (!read_string(file, col.name) || !read_string(file, col.coreid))
+                    return false;
+            values.assign(columns.size(), 0.0);
+            return true;
+        }
+
+        ~Reader()
+        {
+            if (file)
+                fclose(file);
+        }
+
+        bool is_delta() const {return header.flags & DELTA;}
+
+        // returns false at the end of the file, or at a truncated snapshot
+        bool next()
+        {
+            Record rec;
+            if (fread(&rec, sizeof(rec), 1, file) != 1)
+                return false;
+            entries.resize(rec.entries);
+            if (fread(entries.data(), sizeof(Entry), rec.entries, file) != rec.entries)
+                return false;
+            if (is_delta())
+                values.assign(columns.size(), 0.0);
+            for (auto& entry : entries) {
+                if (entry.column >= values.size())
+                    return false;
+                values[entry.column] = entry.value;
+            }
+            cycle = rec.cycle;
+            return true;
+        }
+
+    private:
+        FILE* file = nullptr;
+        std::vector<Entry> entries;
+    };
+} /* namespace EpochStats */
+
+} /* namespace ramulator */
+
+#endif /* __STATS_FORMAT_H */
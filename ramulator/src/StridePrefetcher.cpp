@@ -1,4 +1,5 @@
 #include "StridePrefetcher.h"
+#include "Checkpoint.h"
 #include <stdio.h>
 namespace ramulator
 {
@@ -28,6 +29,12 @@ namespace ramulator
         delete[] index_table;
     }
 
+    void StridePrefetcher::checkpoint(Checkpoint& ckpt) {
+        ckpt.check(num_entries, "stride prefetcher entries");
+        ckpt.io(region_table, num_entries);
+        ckpt.io(index_table, num_entries);
+    }
+
     void StridePrefetcher::train(long line_addr, bool ul1_hit, long cur_clk, ulong sector_bits) {
        
        int region_idx = -1;
@@ -19,6 +19,8 @@
 
 namespace ramulator
 {
+    class Checkpoint;
+
     class StridePrefetcher {
         protected:
             struct StrideRegionTableEntry {
@@ -91,6 +93,8 @@ namespace ramulator
 
             void create_new_entry(int idx, long line_addr, long region_tag, long cur_clk);
 
+            void checkpoint(Checkpoint& ckpt);
+
     };
 
 } // namespace ramulator
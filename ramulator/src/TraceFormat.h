@@ -0,0 +1,82 @@
+#ifndef __TRACE_FORMAT_H
+#define __TRACE_FORMAT_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace ramulator
+{
+
+/*
+  Binary CPU trace: a header followed by fixed-width records, one per
+  load/store. It holds the same information as a text trace line
+  ("<inst-addr(hex)> <num-cpuinst> <R/W> <addr(hex)> <size>") and is
+  memory-mapped by Trace, so no parsing is needed at simulation time.
+  Records are stored in the byte order of the machine that converted them.
+*/
+namespace BinaryTrace
+{
+    const char MAGIC[8] = {'R', 'A', 'M', 'T', 'R', 'C', 'B', 'N'};
+    const uint32_t VERSION = 1;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+    };
+
+    struct Record
+    {
+        uint64_t inst_addr;
+        uint64_t addr;
+        uint32_t bubble_cnt;
+        uint16_t size; // saturated, the simulator ignores requests larger than a cache block
+        uint8_t is_write;
+        uint8_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 16, "unexpected binary trace header layout");
+    static_assert(sizeof(Record) == 24, "unexpected binary trace record layout");
+
+    inline bool is_binary(const Header& header)
+    {
+        return memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+    // parse one line of a text CPU trace, returns false if the line is malformed
+    inline bool parse_line(const char* line, Record& rec)
+    {
+        char* end;
+        rec.inst_addr = strtoul(line, &end, 16);
+        if (end == line)
+            return false;
+        line = end;
+        rec.bubble_cnt = strtoul(line, &end, 10);
+        if (end == line)
+            return false;
+        line = end;
+        while (*line == ' ')
+            line++;
+        if (*line == '\0')
+            return false;
+        rec.is_write = (*line != 'R');
+        while (*line != ' ' && *line != '\0')
+            line++;
+        rec.addr = strtoul(line, &end, 16);
+        if (end == line)
+            return false;
+        line = end;
+        unsigned long size = strtoul(line, &end, 10);
+        if (end == line)
+            return false;
+        rec.size = size > UINT16_MAX ? UINT16_MAX : size;
+        rec.reserved = 0;
+        return true;
+    }
+} /* namespace BinaryTrace */
+
+} /* namespace ramulator */
+
+#endif /* __TRACE_FORMAT_H */
@@ -0,0 +1,158 @@
+#include "TraceReader.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sys/wait.h>
+
+using namespace std;
+using namespace ramulator;
+
+static bool ends_with(const string& str, const string& suffix)
+{
+    return str.size() >= suffix.size() &&
+        str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+string TraceReader::decompress_command(const string& trace_fname)
+{
+    if (ends_with(trace_fname, ".gz"))
+        return "gzip -dc";
+    if (ends_with(trace_fname, ".zst") || ends_with(trace_fname, ".zstd"))
+        return "zstd -dcq";
+    return "";
+}
+
+TraceReader::TraceReader(const string& trace_fname, const string& command)
+    : trace_name(trace_fname), ring(CAPACITY)
+{
+    // quote the file name for the shell
+    string quoted = "'";
+    for (char c : trace_fname) {
+        if (c == '\'')
+            quoted += "'\\''";
+        else
+            quoted += c;
+    }
+    quoted += "'";
+    this->command = command + " " + quoted;
+
+    thread = std::thread(&TraceReader::run, this);
+}
+
+TraceReader::~TraceReader()
+{
+    stop = true;
+    thread.join();
+}
+
+void* TraceReader::operator new(size_t size)
+{
+    void* ptr;
+    if (posix_memalign(&ptr, alignof(TraceReader), size))
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void TraceReader::operator delete(void* ptr)
+{
+    free(ptr);
+}
+
+bool TraceReader::push(const BinaryTrace::Record& rec)
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head_cached == CAPACITY) {
+        while ((head_cached = head_shared.load(std::memory_order_acquire)) + CAPACITY == t) {
+            if (stop)
+                return false;
+            std::this_thread::yield();
+        }
+    }
+    ring[t & (CAPACITY - 1)] = rec;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+long TraceReader::read_pass()
+{
+    FILE* in = popen(command.c_str(), "r");
+    if (!in) {
+        cerr << "Cannot run \"" << command << "\"" << endl;
+        exit(1);
+    }
+
+    long records = 0;
+    bool cut_short = false; // stopped before the end of the trace
+    BinaryTrace::Header header;
+    size_t header_bytes = fread(&header, 1, sizeof(header), in);
+
+    if (header_bytes == sizeof(header) && BinaryTrace::is_binary(header)) {
+        if (header.version != BinaryTrace::VERSION || header.record_size != sizeof(BinaryTrace::Record)) {
+            cerr << "Unsupported binary trace version " << header.version << ": " << trace_name << endl;
+            exit(1);
+        }
+        BinaryTrace::Record rec;
+        while (fread(&rec, sizeof(rec), 1, in) == 1) {
+            if (!push(rec)) {
+                cut_short = true;
+                break;
+            }
+            records++;
+        }
+    } else {
+        // text trace, the bytes read for the header start the first line
+        vector<char> buf(1 << 20);
+        memcpy(buf.data(), &header, header_bytes);
+        size_t start = 0, len = header_bytes;
+        bool more = true;
+        while (more) {
+            char* eol;
+            while (more && (eol = (char*) memchr(buf.data() + start, '\n', len - start))) {
+                *eol = '\0';
+                BinaryTrace::Record rec;
+                if (!BinaryTrace::parse_line(&buf[start], rec)) {
+                    cerr << "Bad line in trace file " << trace_name << ": " << &buf[start] << endl;
+                    exit(1);
+                }
+                more = push(rec);
+                cut_short = !more;
+                records++;
+                start = eol - buf.data() + 1;
+            }
+
+            // keep the incomplete line and read more of the trace after it
+            memmove(buf.data(), buf.data() + start, len - start);
+            len -= start;
+            start = 0;
+            if (len == buf.size())
+                buf.resize(2 * buf.size());
+            size_t bytes = fread(&buf[len], 1, buf.size() - len, in);
+            if (bytes == 0)
+                break; // like the uncompressed reader, drop a last line without a newline
+            len += bytes;
+        }
+    }
+
+    // the decompressor of a pass cut short may be killed by the closed pipe
+    int status = pclose(in);
+    if (!cut_short && (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+        cerr << "\"" << command << "\" failed";
+        if (status != -1 && WIFEXITED(status))
+            cerr << " with exit status " << WEXITSTATUS(status);
+        cerr << endl;
+        exit(1);
+    }
+    return records;
+}
+
+void TraceReader::run()
+{
+    while (!stop) {
+        if (read_pass() == 0 && !stop) {
+            cerr << "Cannot read any request from \"" << command << "\"" << endl;
+            exit(1);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef __TRACE_READER_H
+#define __TRACE_READER_H
+
+#include "TraceFormat.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ramulator
+{
+
+/*
+  Reads a compressed CPU trace (text or binary, see TraceFormat.h) on a
+  background thread. The trace is decompressed by an external process
+  (gzip/zstd) and parsed by the thread into a bounded single-producer
+  single-consumer ring buffer, so decompression and parsing overlap with
+  the simulation. Like the uncompressed readers, it starts over at the
+  end of the trace.
+*/
+class TraceReader
+{
+public:
+    // decompression command for a trace file name, empty if it is not compressed
+    static std::string decompress_command(const std::string& trace_fname);
+
+    TraceReader(const std::string& trace_fname, const std::string& command);
+    ~TraceReader();
+
+    // the members are cache line aligned, which new only guarantees since C++17
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
+    // next record of the trace, waits for the reader thread if none is decoded yet
+    void next(BinaryTrace::Record& rec)
+    {
+        if (head == tail_cached) {
+            while ((tail_cached = tail.load(std::memory_order_acquire)) == head)
+                std::this_thread::yield();
+        }
+        rec = ring[head & (CAPACITY - 1)];
+        head++;
+        head_shared.store(head, std::memory_order_release);
+    }
+
+private:
+    static const size_t CAPACITY = 1 << 16; // records, power of two
+
+    void run();
+    // one pass over the trace, returns the number of records read
+    long read_pass();
+    bool push(const BinaryTrace::Record& rec);
+
+    std::string trace_name;
+    std::string command;
+    std::vector<BinaryTrace::Record> ring;
+
+    // consumer side
+    size_t head = 0;
+    size_t tail_cached = 0;
+    alignas(64) std::atomic<size_t> head_shared{0};
+
+    // producer side
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t head_cached = 0;
+    std::atomic<bool> stop{false};
+
+    std::thread thread;
+};
+
+} /* namespace ramulator */
+
+#endif /* __TRACE_READER_H */
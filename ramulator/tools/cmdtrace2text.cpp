@@ -0,0 +1,81 @@
+/*
+  Converts a binary DRAM command trace that ramulator writes with
+  cmd_trace_format = binary (see src/CmdTraceFormat.h) to the text command
+  trace read by DRAMPower: a line per command with its cycle, the command
+  name and, depending on the command, the bank and the activated sectors.
+
+  usage: cmdtrace2text <binary-trace> <text-trace>
+*/
+
+#include "CmdTraceFormat.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace ramulator;
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <binary-trace> <text-trace>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    BinaryCmdTrace::Header header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || !BinaryCmdTrace::is_binary(header)
+            || header.version != BinaryCmdTrace::VERSION
+            || header.record_size != sizeof(BinaryCmdTrace::Record)) {
+        fprintf(stderr, "%s is not a binary command trace\n", argv[1]);
+        return 1;
+    }
+    std::vector<BinaryCmdTrace::CommandName> names(header.commands);
+    if (fread(names.data(), sizeof(BinaryCmdTrace::CommandName), names.size(), in) != names.size()) {
+        fprintf(stderr, "%s is truncated\n", argv[1]);
+        return 1;
+    }
+    for (auto& name : names)
+        name.name[sizeof(name.name) - 1] = '\0';
+
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+        fprintf(stderr, "Cannot create %s\n", argv[2]);
+        return 1;
+    }
+
+    std::vector<BinaryCmdTrace::Record> records(1 << 16);
+    unsigned long clk = 0;
+    size_t n;
+    while ((n = fread(records.data(), sizeof(BinaryCmdTrace::Record), records.size(), in)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            auto& rec = records[i];
+            clk += rec.delta;
+            if (rec.command == BinaryCmdTrace::NO_COMMAND)
+                continue;
+            if (rec.command >= names.size()) {
+                fprintf(stderr, "%s has an unknown command %u\n", argv[1], rec.command);
+                return 1;
+            }
+            const char* name = names[rec.command].name;
+            fprintf(out, "%lu,%s", clk, name);
+            if (BinaryCmdTrace::has_sectors(name))
+                fprintf(out, ",%u,%u\n", rec.bank, rec.sectors);
+            else if (BinaryCmdTrace::has_bank(name))
+                fprintf(out, ",%u\n", rec.bank);
+            else
+                fprintf(out, "\n");
+        }
+    }
+    fclose(in);
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}
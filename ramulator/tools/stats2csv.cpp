@@ -0,0 +1,60 @@
+/*
+  Exports the epoch statistics that ramulator writes with stats_epoch (see
+  src/StatsFormat.h) as CSV: a row per snapshot and a column per stat, named
+  <stat> for the total and <stat>[<coreid>] for an element of a vector stat.
+  Stats can be selected by name, all of them are exported by default.
+
+  usage: stats2csv <epoch-stats> [<stat-name> ...]
+*/
+
+#include "StatsFormat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace ramulator;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <epoch-stats> [<stat-name> ...]\n", argv[0]);
+        return 1;
+    }
+
+    EpochStats::Reader reader;
+    if (!reader.open(argv[1])) {
+        fprintf(stderr, "%s is not an epoch stats file\n", argv[1]);
+        return 1;
+    }
+
+    std::set<std::string> names(&argv[2], &argv[argc]);
+    std::vector<size_t> selected;
+    for (size_t i = 0; i < reader.columns.size(); i++)
+        if (names.empty() || names.count(reader.columns[i].name))
+            selected.push_back(i);
+    if (selected.empty()) {
+        fprintf(stderr, "None of the stats is in %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("cycle");
+    for (size_t i : selected) {
+        auto& col = reader.columns[i];
+        if (col.coreid == "ALL")
+            printf(",%s", col.name.c_str());
+        else
+            printf(",%s[%s]", col.name.c_str(), col.coreid.c_str());
+    }
+    printf("\n");
+
+    while (reader.next()) {
+        printf("%lu", (unsigned long) reader.cycle);
+        for (size_t i : selected)
+            printf(",%.6g", reader.values[i]);
+        printf("\n");
+    }
+    return 0;
+}
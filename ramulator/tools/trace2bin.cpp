@@ -0,0 +1,79 @@
+/*
+  Converts a text CPU trace (as written by TraceGenerator's gettrace tool)
+  into the binary trace format that ramulator memory-maps (see
+  src/TraceFormat.h). Ramulator detects the format of a trace file by its
+  header, so the converted file can be passed wherever the text trace was.
+
+  usage: trace2bin <text-trace> <binary-trace>
+*/
+
+#include "TraceFormat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace ramulator;
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <text-trace> <binary-trace>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "r");
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    FILE* out = fopen(argv[2], "wb");
+    if (!out) {
+        fprintf(stderr, "Cannot create %s\n", argv[2]);
+        return 1;
+    }
+
+    BinaryTrace::Header header;
+    memcpy(header.magic, BinaryTrace::MAGIC, sizeof(header.magic));
+    header.version = BinaryTrace::VERSION;
+    header.record_size = sizeof(BinaryTrace::Record);
+    fwrite(&header, sizeof(header), 1, out);
+
+    const size_t BATCH = 1 << 16;
+    std::vector<BinaryTrace::Record> batch;
+    batch.reserve(BATCH);
+
+    char* line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    long line_num = 0, records = 0;
+    while ((len = getline(&line, &line_cap, in)) != -1) {
+        line_num++;
+        // like the text reader in ramulator, drop a last line without a newline
+        if (line[len - 1] != '\n')
+            break;
+
+        BinaryTrace::Record rec;
+        if (!BinaryTrace::parse_line(line, rec)) {
+            fprintf(stderr, "%s:%ld: malformed line: %s", argv[1], line_num, line);
+            return 1;
+        }
+        batch.push_back(rec);
+        if (batch.size() == BATCH) {
+            fwrite(batch.data(), sizeof(BinaryTrace::Record), batch.size(), out);
+            records += batch.size();
+            batch.clear();
+        }
+    }
+    fwrite(batch.data(), sizeof(BinaryTrace::Record), batch.size(), out);
+    records += batch.size();
+    free(line);
+    fclose(in);
+
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    printf("Converted %ld requests from %s to %s\n", records, argv[1], argv[2]);
+    return 0;
+}